@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sg_copy.h"
+#include "sg_alloc.h"
+#include "sg_iov.h"
+#include "sg_table.h"
+#include "sg_index.h"
+#include "sg_perf.h"
+#include "sg_profile.h"
+
+
+/*
+* Benchmark of the map, copy and destroy routines
+*
+* Note: every API is timed over a sweep of buffer sizes, buffer
+* alignments, source offsets and fragmentation patterns. One CSV line
+* is printed per measurement:
+*
+*   api,pattern,size,align,offset,entries,ns_per_op,gb_per_s,allocs_per_op
+*
+* "memcpy" lines are the flat copy baseline. Pass "-q" for a shorter
+* sweep, "-t <ms>" for the minimum time spent on each measurement.
+* sg_copy_nt streams every copy, whatever its size. "-p" as the first
+* argument compares the list representations instead, see sg_profile.c
+*/
+
+#define SG_BENCH_BATCH 64               // lists mapped per timed batch
+#define SG_BENCH_MAX_ALIGN 64           // slack for misaligned buffers
+
+typedef enum sg_bench_pattern_e {
+  SG_BENCH_PAGES,                       // sg_map, one entry per page
+  SG_BENCH_LARGE,                       // sg_map_geom, 4 KiB entries
+  SG_BENCH_RANDOM,                      // sg_from_iovec, random fragments
+  SG_BENCH_NUM_PATTERNS
+} sg_bench_pattern_t;
+
+static const char* const sg_bench_pattern_name[SG_BENCH_NUM_PATTERNS] = {
+  "pages", "large", "random"
+};
+
+typedef struct sg_bench_s {
+  sg_bench_pattern_t pattern;
+  sg_geom_t geom;
+  char* src_buf;
+  char* dest_buf;
+  int size;
+  int offset;
+  sg_entry_t* src;
+  sg_entry_t* dest;
+  sg_table_t* src_table;
+  sg_table_t* dest_table;
+  sg_index_t* src_index;
+  sg_entry_t* lists[SG_BENCH_BATCH];
+} sg_bench_t;
+
+static double sg_bench_min_ns = 50e6;
+static long sg_bench_allocs;           // allocator calls in the current run
+static double sg_bench_allocs_per_op;  // allocator calls per op in the last timing
+
+// the default allocator, counting its calls
+static sg_entry_t* sg_bench_alloc(void* ctx, int n)
+{
+  (void)ctx;
+  sg_bench_allocs++;
+  return sg_default_allocator.alloc(sg_default_allocator.ctx, n);
+}
+
+static void sg_bench_release(void* ctx, sg_entry_t* head, sg_entry_t* tail, int n)
+{
+  (void)ctx;
+  sg_bench_allocs++;
+  sg_default_allocator.release(sg_default_allocator.ctx, head, tail, n);
+}
+
+static const sg_allocator_t sg_bench_allocator = {
+  sg_bench_alloc, sg_bench_release, NULL
+};
+
+/*
+* sg_bench_map_random Map a buffer as fragments of random length
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+*
+* @ret          A list mapping the buffer, NULL on failure
+*
+* @note         Fragments are 1 to 3 * PAGE_SIZE bytes long and start
+*               anywhere in a page, the sequence is the same on every call.
+*/
+static sg_entry_t* sg_bench_map_random(char* buf, int length)
+{
+  sg_iovec_t* iov;
+  sg_entry_t* list;
+  unsigned int seed = 12345;
+  int num_iov = 0;
+  int done = 0;
+
+  iov = (sg_iovec_t*)malloc(length * sizeof(sg_iovec_t));
+  if (iov == NULL) return NULL;
+
+  while (done < length)
+  {
+    int len;
+
+    seed = seed * 1103515245 + 12345;
+    len = 1 + (int)((seed >> 16) % (3 * PAGE_SIZE));
+    if (len > length - done) len = length - done;
+    iov[num_iov].iov_base = buf + done;
+    iov[num_iov].iov_len = len;
+    num_iov++;
+    done += len;
+  }
+
+  list = sg_from_iovec(iov, num_iov);
+  free(iov);
+
+  return list;
+}
+
+static sg_entry_t* sg_bench_map(sg_bench_t* b, char* buf)
+{
+  if (b->pattern == SG_BENCH_RANDOM) return sg_bench_map_random(buf, b->size);
+
+  return sg_map_geom(buf, b->size, &b->geom, NULL);
+}
+
+static int sg_bench_count_entries(sg_entry_t* sg_list)
+{
+  int num_entries = 0;
+
+  for (; sg_list != NULL && sg_list->count > 0; sg_list = sg_list->next)
+  {
+    num_entries++;
+  }
+
+  return num_entries;
+}
+
+/*
+* sg_bench_time Time a benchmark operation
+*
+* @in b         Benchmark state
+* @in op        Runs the operation "n" times
+* @in calls_per_op Number of times "op" runs the operation per call
+*
+* @ret          Nanoseconds per operation
+*
+* @note         The number of calls doubles until the run lasts at
+*               least sg_bench_min_ns. The allocator calls per operation
+*               of that run are left in sg_bench_allocs_per_op.
+*/
+static double sg_bench_time(sg_bench_t* b, void (*op)(sg_bench_t* b), int calls_per_op)
+{
+  long iterations = 1;
+
+  for (;;)
+  {
+    double start;
+    double elapsed;
+    long i;
+
+    sg_bench_allocs = 0;
+    start = sg_perf_now();
+    for (i = 0; i < iterations; i++)
+    {
+      op(b);
+    }
+    elapsed = sg_perf_now() - start;
+
+    if (elapsed >= sg_bench_min_ns || iterations >= (1L << 30))
+    {
+      sg_bench_allocs_per_op = (double)sg_bench_allocs / ((double)iterations * calls_per_op);
+      return elapsed / ((double)iterations * calls_per_op);
+    }
+    iterations *= 2;
+  }
+}
+
+static void sg_bench_memcpy(sg_bench_t* b)
+{
+  memcpy(b->dest_buf, b->src_buf + b->offset, b->size - b->offset);
+}
+
+static void sg_bench_copy(sg_bench_t* b)
+{
+  sg_copy(b->src, b->dest, b->offset, b->size - b->offset);
+}
+
+static void sg_bench_copy_fast(sg_bench_t* b)
+{
+  sg_copy_fast(b->src, b->dest, b->offset, b->size - b->offset);
+}
+
+static void sg_bench_copy_nt(sg_bench_t* b)
+{
+  sg_copy_nt(b->src, b->dest, b->offset, b->size - b->offset);
+}
+
+static void sg_bench_gather(sg_bench_t* b)
+{
+  sg_gather(b->src, b->offset, b->dest_buf, b->size - b->offset);
+}
+
+static void sg_bench_scatter(sg_bench_t* b)
+{
+  sg_scatter(b->src_buf + b->offset, b->size - b->offset, b->dest, 0);
+}
+
+static void sg_bench_copy_table(sg_bench_t* b)
+{
+  sg_copy_table(b->src_table, b->dest_table, b->offset, b->size - b->offset);
+}
+
+static void sg_bench_copy_indexed(sg_bench_t* b)
+{
+  sg_copy_indexed(b->src_index, b->dest, b->offset, b->size - b->offset);
+}
+
+static void sg_bench_map_destroy(sg_bench_t* b)
+{
+  int i;
+
+  for (i = 0; i < SG_BENCH_BATCH; i++)
+  {
+    b->lists[i] = sg_map_geom(b->src_buf, b->size, &b->geom, &sg_bench_allocator);
+  }
+  for (i = 0; i < SG_BENCH_BATCH; i++)
+  {
+    sg_destroy_with(b->lists[i], &sg_bench_allocator);
+  }
+}
+
+/*
+* sg_bench_report Print one measurement
+*
+* @in b         Benchmark state
+* @in api       Name of the timed API
+* @in align     Misalignment of the buffers
+* @in ns        Nanoseconds per operation
+* @in bytes     Bytes processed per operation
+*/
+static void sg_bench_report(const sg_bench_t* b, const char* api, int align,
+                            double ns, int bytes)
+{
+  printf("%s,%s,%d,%d,%d,%d,%.1f,%.3f,%.2f\n",
+         api, sg_bench_pattern_name[b->pattern], b->size, align, b->offset,
+         sg_bench_count_entries(b->src), ns, bytes / ns, sg_bench_allocs_per_op);
+}
+
+/*
+* sg_bench_run  Time every API for one point of the sweep
+*
+* @in b         Benchmark state, pattern, size and offset set
+* @in src_base  Source storage, at least size + SG_BENCH_MAX_ALIGN bytes
+* @in dest_base Destination storage, at least size + SG_BENCH_MAX_ALIGN bytes
+* @in align     Misalignment of both buffers
+*/
+static void sg_bench_run(sg_bench_t* b, char* src_base, char* dest_base, int align)
+{
+  int copied = b->size - b->offset;
+
+  b->src_buf = src_base + align;
+  b->dest_buf = dest_base + align;
+  b->src = sg_bench_map(b, b->src_buf);
+  b->dest = sg_bench_map(b, b->dest_buf);
+  b->src_table = sg_table_from_list(b->src);
+  b->dest_table = sg_table_from_list(b->dest);
+  b->src_index = sg_index_build(b->src);
+  if (b->src == NULL || b->dest == NULL || b->src_table == NULL ||
+      b->dest_table == NULL || b->src_index == NULL)
+  {
+    fprintf(stderr, "sg_bench: out of memory at size %d\n", b->size);
+    exit(1);
+  }
+
+  sg_bench_report(b, "memcpy", align, sg_bench_time(b, sg_bench_memcpy, 1), copied);
+  sg_bench_report(b, "sg_copy", align, sg_bench_time(b, sg_bench_copy, 1), copied);
+  sg_bench_report(b, "sg_copy_fast", align, sg_bench_time(b, sg_bench_copy_fast, 1), copied);
+  sg_bench_report(b, "sg_copy_nt", align, sg_bench_time(b, sg_bench_copy_nt, 1), copied);
+  sg_bench_report(b, "sg_gather", align, sg_bench_time(b, sg_bench_gather, 1), copied);
+  sg_bench_report(b, "sg_scatter", align, sg_bench_time(b, sg_bench_scatter, 1), copied);
+  sg_bench_report(b, "sg_copy_table", align,
+                  sg_bench_time(b, sg_bench_copy_table, 1), copied);
+  sg_bench_report(b, "sg_copy_indexed", align,
+                  sg_bench_time(b, sg_bench_copy_indexed, 1), copied);
+
+  // mapping cost does not depend on the source offset
+  if (b->pattern != SG_BENCH_RANDOM && b->offset == 0)
+  {
+    sg_bench_report(b, "sg_map+sg_destroy", align,
+                    sg_bench_time(b, sg_bench_map_destroy, SG_BENCH_BATCH), b->size);
+  }
+
+  sg_index_destroy(b->src_index);
+  sg_table_destroy(b->src_table);
+  sg_table_destroy(b->dest_table);
+  sg_destroy(b->src);
+  sg_destroy(b->dest);
+}
+
+int main(int argc, char* argv[])
+{
+  static const int sizes[] = { 64, 1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024 };
+  static const int aligns[] = { 0, 1, 7 };
+  static const int offsets[] = { 0, 13 };
+  int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+  int num_aligns = sizeof(aligns) / sizeof(aligns[0]);
+  sg_bench_t b;
+  char* src_base;
+  char* dest_base;
+  int max_size;
+  int p, s, a, o;
+  int i;
+
+  if (argc > 1 && strcmp(argv[1], "-p") == 0) return sg_profile_main(argc - 1, argv + 1);
+
+  for (i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-q") == 0)
+    {
+      num_sizes = 3;
+      num_aligns = 1;
+      sg_bench_min_ns = 10e6;
+    }
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+    {
+      sg_bench_min_ns = atof(argv[++i]) * 1e6;
+    }
+    else
+    {
+      fprintf(stderr, "usage: %s [-p] [-q] [-t min_ms]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sg_set_nt_threshold(0);
+
+  max_size = sizes[num_sizes - 1];
+  src_base = (char*)malloc(max_size + SG_BENCH_MAX_ALIGN);
+  dest_base = (char*)malloc(max_size + SG_BENCH_MAX_ALIGN);
+  if (src_base == NULL || dest_base == NULL) return 1;
+  memset(src_base, 0x5a, max_size + SG_BENCH_MAX_ALIGN);
+  memset(dest_base, 0, max_size + SG_BENCH_MAX_ALIGN);
+
+  printf("api,pattern,size,align,offset,entries,ns_per_op,gb_per_s,allocs_per_op\n");
+
+  for (p = 0; p < SG_BENCH_NUM_PATTERNS; p++)
+  {
+    b.pattern = (sg_bench_pattern_t)p;
+    if (b.pattern == SG_BENCH_LARGE)
+      sg_geom_init(&b.geom, 4096);
+    else
+      b.geom = sg_default_geom;
+
+    for (s = 0; s < num_sizes; s++)
+    {
+      b.size = sizes[s];
+      for (a = 0; a < num_aligns; a++)
+      {
+        for (o = 0; o < (int)(sizeof(offsets) / sizeof(offsets[0])); o++)
+        {
+          b.offset = offsets[o];
+          sg_bench_run(&b, src_base, dest_base, aligns[a]);
+        }
+      }
+      fflush(stdout);
+    }
+  }
+
+  free(src_base);
+  free(dest_base);
+
+  return 0;
+}
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include "sg_frag.h"
+#include "sg_list.h"
+
+/*
+* sg_frag_rand  Step a random sequence
+*
+* @in seed      State of the sequence
+*
+* @ret          The next value of the sequence
+*/
+static unsigned int sg_frag_rand(unsigned int* seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/*
+* sg_frag_span  Number of buffer bytes a fragmented payload may occupy
+*
+* @in frag      Fragmentation profile
+* @in length    Payload length in bytes
+*
+* @ret          Size the buffer passed to sg_frag_build must have
+*/
+size_t sg_frag_span(const sg_frag_t* frag, int length)
+{
+  return (size_t)length + ((size_t)length / frag->min_length + 1) * frag->gap;
+}
+
+/*
+* sg_frag_splice Relink a share of the entries of a list at random
+*
+* @in list      An owning list
+* @in splice_pct Percentage of entries relinked
+* @in seed      State of the random sequence
+*
+* @ret          0 on success, -1 on failure
+*/
+static int sg_frag_splice(sg_list_t* list, int splice_pct, unsigned int* seed)
+{
+  sg_entry_t** entries;
+  sg_entry_t* list_curr;
+  int n = list->num_entries;
+  int i;
+
+  entries = (sg_entry_t**)malloc(n * sizeof(sg_entry_t*));
+  if (entries == NULL) return -1;
+
+  list_curr = list->head;
+  for (i = 0; i < n; i++)
+  {
+    entries[i] = list_curr;
+    list_curr = list_curr->next;
+  }
+
+  // each relinked entry trades places with one at or after it
+  for (i = 0; i < n - 1; i++)
+  {
+    if ((int)(sg_frag_rand(seed) % 100) < splice_pct)
+    {
+      int j = i + (int)(sg_frag_rand(seed) % (unsigned int)(n - i));
+      sg_entry_t* tmp = entries[i];
+
+      entries[i] = entries[j];
+      entries[j] = tmp;
+    }
+  }
+
+  for (i = 0; i < n - 1; i++)
+  {
+    entries[i]->next = entries[i + 1];
+  }
+  entries[n - 1]->next = NULL;
+  list->head = entries[0];
+  list->tail = entries[n - 1];
+
+  free(entries);
+
+  return 0;
+}
+
+/*
+* sg_frag_build Map a payload following a fragmentation profile
+*
+* @in frag      Fragmentation profile
+* @in buf       Buffer of sg_frag_span(frag, length) bytes
+* @in length    Payload length in bytes, positive
+*
+* @ret          A list of "length" bytes, NULL on failure
+*
+* @note         Entries come from sg_default_allocator, the list must be
+*               destroyed by sg_destroy.
+*/
+sg_entry_t* sg_frag_build(const sg_frag_t* frag, char* buf, int length)
+{
+  sg_list_t list;
+  sg_list_t fragment;
+  unsigned int seed = frag->seed;
+  size_t position = 0;
+  int done = 0;
+
+  if (length <= 0) return NULL;
+  if (frag->min_length <= 0 || frag->max_length < frag->min_length) return NULL;
+  if (sg_list_init(&list, NULL, NULL) != 0) return NULL;
+
+  while (done < length)
+  {
+    int fragment_length = frag->min_length +
+      (int)(sg_frag_rand(&seed) % (unsigned int)(frag->max_length - frag->min_length + 1));
+
+    if (fragment_length > length - done) fragment_length = length - done;
+    if (sg_list_map(&fragment, buf + position, fragment_length, NULL, NULL) != 0 ||
+        sg_concat(&list, &fragment) != 0)
+    {
+      sg_list_destroy(&list);
+      return NULL;
+    }
+    position += fragment_length + frag->gap;
+    done += fragment_length;
+  }
+
+  if (frag->splice_pct > 0 && sg_frag_splice(&list, frag->splice_pct, &seed) != 0)
+  {
+    sg_list_destroy(&list);
+    return NULL;
+  }
+
+  return list.head;
+}
+
+/*
+* sg_frag_regular Tell whether a profile maps its payload like sg_map
+*
+* @in frag      Fragmentation profile
+*
+* @ret          Non-zero if the payload is contiguous and in order, so
+*               representations limited to regular mappings apply
+*/
+int sg_frag_regular(const sg_frag_t* frag)
+{
+  return frag->gap == 0 && frag->splice_pct == 0;
+}
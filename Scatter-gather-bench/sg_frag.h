@@ -0,0 +1,61 @@
+#ifndef SG_FRAG_H
+#define SG_FRAG_H
+
+#include "sg_copy.h"
+
+/*
+ * Fragmentation profile
+ *
+ * Note: the payload is cut into fragments of min_length to max_length
+ * bytes, laid out in order in the buffer with "gap" unused bytes after
+ * each one. Every fragment is mapped entry by entry, then splice_pct
+ * percent of the entries are relinked to random positions, as
+ * "head->next = next" splices do. Spliced lists walk their entries, and
+ * read their payload, out of address order. The same seed always gives
+ * the same list
+ */
+typedef struct sg_frag_s sg_frag_t;
+struct sg_frag_s {
+	const char *name;               /* label of the profile */
+	int min_length;                 /* shortest fragment, positive */
+	int max_length;                 /* longest fragment, at least min_length */
+	int gap;                        /* bytes skipped after each fragment */
+	int splice_pct;                 /* percentage of entries relinked */
+	unsigned int seed;              /* seed of the random choices */
+};
+
+/*
+ * sg_frag_span  Number of buffer bytes a fragmented payload may occupy
+ *
+ * @in frag      Fragmentation profile
+ * @in length    Payload length in bytes
+ *
+ * @ret          Size the buffer passed to sg_frag_build must have
+ */
+extern size_t sg_frag_span(const sg_frag_t *frag, int length);
+
+/*
+ * sg_frag_build Map a payload following a fragmentation profile
+ *
+ * @in frag      Fragmentation profile
+ * @in buf       Buffer of sg_frag_span(frag, length) bytes
+ * @in length    Payload length in bytes, positive
+ *
+ * @ret          A list of "length" bytes, NULL on failure
+ *
+ * @note         Entries come from sg_default_allocator, the list must be
+ *               destroyed by sg_destroy.
+ */
+extern sg_entry_t *sg_frag_build(const sg_frag_t *frag, char *buf, int length);
+
+/*
+ * sg_frag_regular Tell whether a profile maps its payload like sg_map
+ *
+ * @in frag      Fragmentation profile
+ *
+ * @ret          Non-zero if the payload is contiguous and in order, so
+ *               representations limited to regular mappings apply
+ */
+extern int sg_frag_regular(const sg_frag_t *frag);
+
+#endif /* SG_FRAG_H */
@@ -0,0 +1,184 @@
+#include <string.h>
+#include "sg_perf.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/*
+* sg_perf_now   Read a monotonic clock
+*
+* @ret          Current time in nanoseconds
+*/
+double sg_perf_now(void)
+{
+#if defined(_WIN32)
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER now;
+
+  if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  return (double)now.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#endif
+}
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const unsigned long long sg_perf_config[SG_PERF_NUM_COUNTERS] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/*
+* sg_perf_open_one Open one hardware counter of the calling thread
+*
+* @in config    PERF_COUNT_HW_* event
+*
+* @ret          The counter's file descriptor, -1 on failure
+*/
+static int sg_perf_open_one(unsigned long long config)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  // this thread, any CPU, no group
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+* sg_perf_open  Open the counters of the calling thread
+*
+* @out perf     Counters to open
+*
+* @ret          0 if at least the cycle counter is available, -1 otherwise
+*
+* @note         The counters start stopped.
+*/
+int sg_perf_open(sg_perf_t* perf)
+{
+  int i;
+
+  for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+  {
+    perf->fd[i] = sg_perf_open_one(sg_perf_config[i]);
+  }
+
+  return perf->fd[SG_PERF_CYCLES] >= 0 ? 0 : -1;
+}
+
+/*
+* sg_perf_start Reset and start the counters
+*
+* @in perf      Counters opened by sg_perf_open
+*/
+void sg_perf_start(sg_perf_t* perf)
+{
+  int i;
+
+  for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+  {
+    if (perf->fd[i] < 0) continue;
+    ioctl(perf->fd[i], PERF_EVENT_IOC_RESET, 0);
+    ioctl(perf->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+/*
+* sg_perf_stop  Stop the counters and read them
+*
+* @in perf      Counters opened by sg_perf_open
+* @out values   Value of each counter since sg_perf_start, -1 for the
+*               counters that are not available
+*/
+void sg_perf_stop(sg_perf_t* perf, double values[SG_PERF_NUM_COUNTERS])
+{
+  int i;
+
+  for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+  {
+    if (perf->fd[i] >= 0) ioctl(perf->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+  {
+    unsigned long long count;
+
+    values[i] = -1;
+    if (perf->fd[i] < 0) continue;
+    if (read(perf->fd[i], &count, sizeof(count)) == (ssize_t)sizeof(count))
+      values[i] = (double)count;
+  }
+}
+
+/*
+* sg_perf_close Close the counters
+*
+* @in perf      Counters opened by sg_perf_open
+*/
+void sg_perf_close(sg_perf_t* perf)
+{
+  int i;
+
+  for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+  {
+    if (perf->fd[i] >= 0) close(perf->fd[i]);
+    perf->fd[i] = -1;
+  }
+}
+
+#else
+
+// no counters outside Linux
+int sg_perf_open(sg_perf_t* perf)
+{
+  int i;
+
+  for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+  {
+    perf->fd[i] = -1;
+  }
+
+  return -1;
+}
+
+void sg_perf_start(sg_perf_t* perf)
+{
+  (void)perf;
+}
+
+void sg_perf_stop(sg_perf_t* perf, double values[SG_PERF_NUM_COUNTERS])
+{
+  int i;
+
+  (void)perf;
+  for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+  {
+    values[i] = -1;
+  }
+}
+
+void sg_perf_close(sg_perf_t* perf)
+{
+  (void)perf;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SG_PERF_H
+#define SG_PERF_H
+
+/*
+ * Hardware performance counters
+ *
+ * Note: counted for the calling thread only, in user mode, through
+ * perf_event on Linux. Elsewhere, or where the kernel refuses access
+ * (see perf_event_paranoid), sg_perf_open fails and no counters are
+ * reported
+ */
+typedef enum sg_perf_counter_e {
+	SG_PERF_CYCLES,
+	SG_PERF_INSTRUCTIONS,
+	SG_PERF_LLC_MISSES,
+	SG_PERF_BRANCH_MISSES,
+	SG_PERF_NUM_COUNTERS
+} sg_perf_counter_t;
+
+typedef struct sg_perf_s sg_perf_t;
+struct sg_perf_s {
+	int fd[SG_PERF_NUM_COUNTERS];   /* one per counter, -1 if not opened */
+};
+
+/*
+ * sg_perf_now   Read a monotonic clock
+ *
+ * @ret          Current time in nanoseconds
+ */
+extern double sg_perf_now(void);
+
+/*
+ * sg_perf_open  Open the counters of the calling thread
+ *
+ * @out perf     Counters to open
+ *
+ * @ret          0 if at least the cycle counter is available, -1 otherwise
+ *
+ * @note         The counters start stopped.
+ */
+extern int sg_perf_open(sg_perf_t *perf);
+
+/*
+ * sg_perf_start Reset and start the counters
+ *
+ * @in perf      Counters opened by sg_perf_open
+ */
+extern void sg_perf_start(sg_perf_t *perf);
+
+/*
+ * sg_perf_stop  Stop the counters and read them
+ *
+ * @in perf      Counters opened by sg_perf_open
+ * @out values   Value of each counter since sg_perf_start, -1 for the
+ *               counters that are not available
+ */
+extern void sg_perf_stop(sg_perf_t *perf, double values[SG_PERF_NUM_COUNTERS]);
+
+/*
+ * sg_perf_close Close the counters
+ *
+ * @in perf      Counters opened by sg_perf_open
+ */
+extern void sg_perf_close(sg_perf_t *perf);
+
+#endif /* SG_PERF_H */
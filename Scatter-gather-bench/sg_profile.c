@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sg_copy.h"
+#include "sg_kernel.h"
+#include "sg_table.h"
+#include "sg_normalize.h"
+#include "sg_lazy.h"
+#include "sg_frag.h"
+#include "sg_perf.h"
+#include "sg_profile.h"
+
+/*
+* Backend comparison harness
+*
+* Note: every backend copies the same fragmented payload into the same
+* destination buffer, with every page copy kernel the CPU supports. One
+* CSV line is printed per measurement:
+*
+*   backend,kernel,frag,size,entries,ns_per_op,gb_per_s,cycles,
+*   instructions,llc_misses,branch_misses,ok
+*
+* The counters are per copy, and empty when perf_event is unavailable.
+* "ok" is 1 when the destination holds the payload after the copy.
+* Backends limited to regular mappings only run on profiles where
+* sg_frag_regular holds. Pass "-q" for a shorter sweep, "-t <ms>" for the
+* minimum time spent on each measurement, "-k <kernel>" to run a single
+* kernel and "-f min,max,gap,splice" for a single custom profile
+*/
+
+#define SG_PROFILE_COALESCE_PAGE 4096  // page size bounding coalesced entries
+
+typedef struct sg_profile_s {
+  const sg_frag_t* frag;
+  int size;
+  int num_entries;
+  char* src_buf;                        // holds the fragments and gaps
+  char* dest_buf;
+  char* expected;                       // the payload, in list order
+  sg_entry_t* src;                      // the fragmented list
+  sg_entry_t* dest;                     // sg_map of dest_buf
+  sg_table_t* src_table;
+  sg_table_t* dest_table;
+  sg_table_t* src_coalesced;            // normalized src_table
+  sg_table_t* dest_coalesced;
+  sg_lazy_t src_lazy;                   // valid for regular profiles only
+} sg_profile_t;
+
+typedef struct sg_profile_backend_s {
+  const char* name;
+  void (*copy)(sg_profile_t* p);
+  int regular_only;                     // needs sg_frag_regular
+} sg_profile_backend_t;
+
+static double sg_profile_min_ns = 20e6;
+
+static void sg_profile_linked(sg_profile_t* p)
+{
+  sg_copy(p->src, p->dest, 0, p->size);
+}
+
+static void sg_profile_linked_nt(sg_profile_t* p)
+{
+  sg_copy_nt(p->src, p->dest, 0, p->size);
+}
+
+static void sg_profile_gather(sg_profile_t* p)
+{
+  sg_gather(p->src, 0, p->dest_buf, p->size);
+}
+
+static void sg_profile_table(sg_profile_t* p)
+{
+  sg_copy_table(p->src_table, p->dest_table, 0, p->size);
+}
+
+static void sg_profile_coalesced(sg_profile_t* p)
+{
+  sg_copy_table(p->src_coalesced, p->dest_coalesced, 0, p->size);
+}
+
+static void sg_profile_lazy(sg_profile_t* p)
+{
+  sg_copy_lazy(&p->src_lazy, 0, p->dest, p->size);
+}
+
+static const sg_profile_backend_t sg_profile_backends[] = {
+  { "linked", sg_profile_linked, 0 },
+  { "linked_nt", sg_profile_linked_nt, 0 },
+  { "gather", sg_profile_gather, 0 },
+  { "table", sg_profile_table, 0 },
+  { "coalesced", sg_profile_coalesced, 0 },
+  { "lazy", sg_profile_lazy, 1 }
+};
+
+static const char* const sg_profile_kernels[] = {
+  "generic", "sse2", "avx2", "avx512", "neon"
+};
+
+static const sg_frag_t sg_profile_frags[] = {
+  { "contig", 4096, 4096, 0, 0, 1 },
+  { "small", 8, 64, 0, 0, 2 },
+  { "gappy", 16, 256, 64, 0, 3 },
+  { "spliced", 16, 256, 64, 25, 4 },
+  { "shuffled", 16, 256, 0, 100, 5 }
+};
+
+/*
+* sg_profile_setup Build every representation of one workload
+*
+* @in p         Workload, frag and size set
+*
+* @ret          0 on success, -1 on failure
+*/
+static int sg_profile_setup(sg_profile_t* p)
+{
+  sg_geom_t geom;
+  sg_entry_t* list_curr;
+  int done = 0;
+  int i;
+
+  p->src_buf = (char*)malloc(sg_frag_span(p->frag, p->size));
+  p->dest_buf = (char*)malloc(p->size);
+  p->expected = (char*)malloc(p->size);
+  if (p->src_buf == NULL || p->dest_buf == NULL || p->expected == NULL) return -1;
+  for (i = 0; i < p->size; i++)
+  {
+    p->src_buf[i] = (char)(i * 7 + 3);
+  }
+
+  p->src = sg_frag_build(p->frag, p->src_buf, p->size);
+  p->dest = sg_map(p->dest_buf, p->size);
+  if (p->src == NULL || p->dest == NULL) return -1;
+
+  // the payload in list order, to check the backends against
+  p->num_entries = 0;
+  for (list_curr = p->src; list_curr != NULL; list_curr = list_curr->next)
+  {
+    memcpy(p->expected + done, phys_to_ptr(list_curr->paddr), list_curr->count);
+    done += list_curr->count;
+    p->num_entries++;
+  }
+
+  sg_geom_init(&geom, SG_PROFILE_COALESCE_PAGE);
+  p->src_table = sg_table_from_list(p->src);
+  p->dest_table = sg_map_table(p->dest_buf, p->size);
+  p->src_coalesced = sg_normalize_table(p->src, &geom, NULL);
+  p->dest_coalesced = sg_map_table_geom(p->dest_buf, p->size, &geom);
+  if (p->src_table == NULL || p->dest_table == NULL ||
+      p->src_coalesced == NULL || p->dest_coalesced == NULL) return -1;
+
+  if (sg_frag_regular(p->frag))
+  {
+    if (sg_lazy_map(&p->src_lazy, p->src_buf, p->size, NULL) != 0) return -1;
+  }
+
+  return 0;
+}
+
+/*
+* sg_profile_teardown Release every representation of one workload
+*
+* @in p         Workload set up by sg_profile_setup, even partly
+*/
+static void sg_profile_teardown(sg_profile_t* p)
+{
+  sg_table_destroy(p->dest_coalesced);
+  sg_table_destroy(p->src_coalesced);
+  sg_table_destroy(p->dest_table);
+  sg_table_destroy(p->src_table);
+  sg_destroy(p->dest);
+  sg_destroy(p->src);
+  free(p->expected);
+  free(p->dest_buf);
+  free(p->src_buf);
+}
+
+/*
+* sg_profile_time Time one backend and count its hardware events
+*
+* @in p         Workload
+* @in backend   Backend to time
+* @in perf      Hardware counters
+* @out counters Events per copy, -1 for the unavailable ones
+*
+* @ret          Nanoseconds per copy
+*
+* @note         The number of copies doubles until the run lasts at least
+*               sg_profile_min_ns, the counters cover that last run.
+*/
+static double sg_profile_time(sg_profile_t* p, const sg_profile_backend_t* backend,
+                              sg_perf_t* perf, double counters[SG_PERF_NUM_COUNTERS])
+{
+  long iterations = 1;
+
+  // warm the caches and the kernel selection up
+  backend->copy(p);
+
+  for (;;)
+  {
+    double start;
+    double elapsed;
+    long i;
+
+    sg_perf_start(perf);
+    start = sg_perf_now();
+    for (i = 0; i < iterations; i++)
+    {
+      backend->copy(p);
+    }
+    elapsed = sg_perf_now() - start;
+    sg_perf_stop(perf, counters);
+
+    if (elapsed >= sg_profile_min_ns || iterations >= (1L << 30))
+    {
+      for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+      {
+        if (counters[i] >= 0) counters[i] /= (double)iterations;
+      }
+      return elapsed / (double)iterations;
+    }
+    iterations *= 2;
+  }
+}
+
+/*
+* sg_profile_check Tell whether a backend copies the payload correctly
+*
+* @in p         Workload
+* @in backend   Backend to check
+*
+* @ret          1 if the destination holds the payload, 0 otherwise
+*/
+static int sg_profile_check(sg_profile_t* p, const sg_profile_backend_t* backend)
+{
+  memset(p->dest_buf, 0, p->size);
+  backend->copy(p);
+
+  return memcmp(p->dest_buf, p->expected, p->size) == 0;
+}
+
+/*
+* sg_profile_report Print one measurement
+*
+* @in p         Workload
+* @in backend   Backend measured
+* @in ns        Nanoseconds per copy
+* @in counters  Events per copy, -1 for the unavailable ones
+* @in ok        Result of sg_profile_check
+*/
+static void sg_profile_report(const sg_profile_t* p, const sg_profile_backend_t* backend,
+                              double ns, const double counters[SG_PERF_NUM_COUNTERS], int ok)
+{
+  int i;
+
+  printf("%s,%s,%s,%d,%d,%.1f,%.3f", backend->name, sg_kernel_name(),
+         p->frag->name, p->size, p->num_entries, ns, p->size / ns);
+  for (i = 0; i < SG_PERF_NUM_COUNTERS; i++)
+  {
+    if (counters[i] >= 0)
+      printf(",%.1f", counters[i]);
+    else
+      printf(",");
+  }
+  printf(",%d\n", ok);
+}
+
+/*
+* sg_profile_parse_frag Read a custom fragmentation profile
+*
+* @in spec      "min,max,gap,splice"
+* @out frag     The profile
+*
+* @ret          0 on success, -1 if the spec is malformed
+*/
+static int sg_profile_parse_frag(const char* spec, sg_frag_t* frag)
+{
+  frag->name = "custom";
+  frag->seed = 1;
+  if (sscanf(spec, "%d,%d,%d,%d", &frag->min_length, &frag->max_length,
+             &frag->gap, &frag->splice_pct) != 4) return -1;
+  if (frag->min_length <= 0 || frag->max_length < frag->min_length) return -1;
+  if (frag->gap < 0 || frag->splice_pct < 0 || frag->splice_pct > 100) return -1;
+
+  return 0;
+}
+
+/*
+* sg_profile_main Compare the list representations and copy kernels
+*
+* @in argc      Number of arguments, argv[0] being the mode flag
+* @in argv      Arguments
+*
+* @ret          Exit status of the benchmark
+*
+* @note         Run by "sg_bench -p". Every backend copies the same
+*               fragmented payloads with every kernel the CPU supports,
+*               one CSV line per measurement.
+*/
+int sg_profile_main(int argc, char* argv[])
+{
+  static const int sizes[] = { 4096, 64 * 1024, 1024 * 1024 };
+  int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+  int num_backends = sizeof(sg_profile_backends) / sizeof(sg_profile_backends[0]);
+  int num_kernels = sizeof(sg_profile_kernels) / sizeof(sg_profile_kernels[0]);
+  const sg_frag_t* frags = sg_profile_frags;
+  int num_frags = sizeof(sg_profile_frags) / sizeof(sg_profile_frags[0]);
+  const char* only_kernel = NULL;
+  sg_frag_t custom;
+  sg_perf_t perf;
+  int status = 0;
+  int f, s, k, b;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-q") == 0)
+    {
+      num_sizes = 2;
+      sg_profile_min_ns = 5e6;
+    }
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+    {
+      sg_profile_min_ns = atof(argv[++i]) * 1e6;
+    }
+    else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+    {
+      only_kernel = argv[++i];
+    }
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc &&
+             sg_profile_parse_frag(argv[++i], &custom) == 0)
+    {
+      frags = &custom;
+      num_frags = 1;
+    }
+    else
+    {
+      fprintf(stderr, "usage: sg_bench -p [-q] [-t min_ms] [-k kernel] "
+                      "[-f min,max,gap,splice]\n");
+      return 2;
+    }
+  }
+
+  if (sg_perf_open(&perf) != 0)
+  {
+    fprintf(stderr, "sg_bench: hardware counters unavailable\n");
+  }
+  sg_set_nt_threshold(0);
+
+  printf("backend,kernel,frag,size,entries,ns_per_op,gb_per_s,"
+         "cycles,instructions,llc_misses,branch_misses,ok\n");
+
+  for (k = 0; k < num_kernels; k++)
+  {
+    if (only_kernel != NULL && strcmp(only_kernel, sg_profile_kernels[k]) != 0) continue;
+    if (sg_kernel_force(sg_profile_kernels[k]) != 0) continue;
+
+    for (f = 0; f < num_frags; f++)
+    {
+      for (s = 0; s < num_sizes; s++)
+      {
+        sg_profile_t p;
+
+        memset(&p, 0, sizeof(p));
+        p.frag = &frags[f];
+        p.size = sizes[s];
+        if (sg_profile_setup(&p) != 0)
+        {
+          fprintf(stderr, "sg_bench: out of memory at size %d\n", p.size);
+          sg_profile_teardown(&p);
+          sg_perf_close(&perf);
+          return 1;
+        }
+
+        for (b = 0; b < num_backends; b++)
+        {
+          const sg_profile_backend_t* backend = &sg_profile_backends[b];
+          double counters[SG_PERF_NUM_COUNTERS];
+          double ns;
+          int ok;
+
+          if (backend->regular_only && !sg_frag_regular(p.frag)) continue;
+
+          ns = sg_profile_time(&p, backend, &perf, counters);
+          ok = sg_profile_check(&p, backend);
+          if (!ok) status = 1;
+          sg_profile_report(&p, backend, ns, counters, ok);
+        }
+
+        sg_profile_teardown(&p);
+        fflush(stdout);
+      }
+    }
+  }
+
+  sg_perf_close(&perf);
+
+  // a backend copying wrong bytes fails the run
+  return status;
+}
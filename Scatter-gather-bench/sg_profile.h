@@ -0,0 +1,18 @@
+#ifndef SG_PROFILE_H
+#define SG_PROFILE_H
+
+/*
+ * sg_profile_main Compare the list representations and copy kernels
+ *
+ * @in argc      Number of arguments, argv[0] being the mode flag
+ * @in argv      Arguments
+ *
+ * @ret          Exit status of the benchmark
+ *
+ * @note         Run by "sg_bench -p". Every backend copies the same
+ *               fragmented payloads with every kernel the CPU supports,
+ *               one CSV line per measurement.
+ */
+extern int sg_profile_main(int argc, char *argv[]);
+
+#endif /* SG_PROFILE_H */
@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include "sg_copy.h"
+
+int main(void)
+{
+  // example
+  int var[200];
+  int var2[200];
+  int var3[200];
+
+  sg_entry_t* head = sg_map(&var, 74);
+  sg_entry_t* next = sg_map(&var2, 68);
+  sg_entry_t* dest = sg_map(&var3, 96);
+
+  sg_destroy(head->next);
+  head->next = next;
+
+  int bytes_copied = sg_copy(head, dest, 6, 115);
+  printf("%d bytes copied\n", bytes_copied);
+
+  sg_destroy(next);
+  sg_destroy(head);
+  sg_destroy(dest);
+
+  return 1;
+}
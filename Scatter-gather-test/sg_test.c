@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sg_test.h"
+
+/*
+* Test driver
+*
+* Note: "sg_test" runs every suite, "sg_test <suite> [seed]" runs one,
+* "all" names every suite.
+* The exit status is 0 when every check passed, 1 otherwise. CTest runs
+* each suite as its own test
+*/
+
+typedef struct sg_test_suite_s {
+  const char* name;
+  sg_test_fn run;
+} sg_test_suite_t;
+
+static const sg_test_suite_t sg_test_suites[] = {
+  { "copy", sg_test_copy },
+  { "move", sg_test_move },
+  { "pool", sg_test_pool },
+  { "normalize", sg_test_normalize },
+  { "list", sg_test_list }
+};
+
+#define SG_TEST_NUM_SUITES ((int)(sizeof(sg_test_suites) / sizeof(sg_test_suites[0])))
+
+static unsigned int sg_test_seed;
+
+/*
+* sg_test_rand  Step the random sequence of the tests
+*
+* @ret          The next value of the sequence, 24 random bits
+*/
+unsigned int sg_test_rand(void)
+{
+  sg_test_seed = sg_test_seed * 1103515245 + 12345;
+  return sg_test_seed >> 8;
+}
+
+/*
+* sg_test_range Draw a random number in a range
+*
+* @in min       Smallest value
+* @in max       Largest value, at least min
+*
+* @ret          A value from min to max
+*/
+int sg_test_range(int min, int max)
+{
+  return min + (int)(sg_test_rand() % (unsigned int)(max - min + 1));
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int seed = (unsigned int)time(NULL);
+  int failures = 0;
+  int found = 0;
+  int i;
+
+  if (argc > 2) seed = (unsigned int)strtoul(argv[2], NULL, 0);
+
+  for (i = 0; i < SG_TEST_NUM_SUITES; i++)
+  {
+    int suite_failures;
+
+    if (argc > 1 && strcmp(argv[1], "all") != 0 &&
+        strcmp(argv[1], sg_test_suites[i].name) != 0) continue;
+    found = 1;
+
+    // every suite starts from the seed, so it replays on its own
+    sg_test_seed = seed;
+    suite_failures = sg_test_suites[i].run();
+    printf("%s: %s (seed %u)\n", sg_test_suites[i].name,
+           suite_failures == 0 ? "passed" : "FAILED", seed);
+    failures += suite_failures;
+  }
+
+  if (!found)
+  {
+    fprintf(stderr, "usage: %s [all|suite [seed]]\n", argv[0]);
+    return 2;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#ifndef SG_TEST_H
+#define SG_TEST_H
+
+#include <stdio.h>
+
+/*
+ * Test suites
+ *
+ * Note: every suite returns its number of failed checks, 0 when it
+ * passes. Random choices come from sg_test_rand, seeded by sg_test so
+ * a failing run can be replayed with the seed it prints
+ */
+typedef int (*sg_test_fn)(void);
+
+/*
+ * SG_TEST_CHECK Count a failed check and report where it failed
+ *
+ * @in cond      Condition expected to hold
+ *
+ * @note         Adds to an int named "failures", which must be in scope.
+ */
+#define SG_TEST_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			if (failures < 10) \
+				fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+/*
+ * sg_test_rand  Step the random sequence of the tests
+ *
+ * @ret          The next value of the sequence, 24 random bits
+ */
+extern unsigned int sg_test_rand(void);
+
+/*
+ * sg_test_range Draw a random number in a range
+ *
+ * @in min       Smallest value
+ * @in max       Largest value, at least min
+ *
+ * @ret          A value from min to max
+ */
+extern int sg_test_range(int min, int max);
+
+/*
+ * sg_test_copy  Compare every copy routine against the reference sg_copy
+ *
+ * @ret          Number of failed checks
+ *
+ * @note         Random lists with empty entries, gaps between the bytes
+ *               they map and entries out of address order are copied by
+ *               sg_copy, sg_copy_fast, sg_copy64, sg_copy_nt,
+ *               sg_copy_csum, sg_move, sg_copy_table, sg_copy_indexed and
+ *               sg_copy_batch. Each must copy the bytes, and return the
+ *               count, of a plain model of the original sg_copy loop.
+ */
+extern int sg_test_copy(void);
+
+/*
+ * sg_test_move  Check sg_move on lists mapping overlapping memory
+ *
+ * @ret          Number of failed checks
+ */
+extern int sg_test_move(void);
+
+/*
+ * sg_test_pool  Check the default allocator across threads
+ *
+ * @ret          Number of failed checks
+ *
+ * @note         Lists are mapped on some threads and destroyed on others,
+ *               so entries are reused through the depot. Entries handed
+ *               out twice show up as lists that change under their owner.
+ */
+extern int sg_test_pool(void);
+
+/*
+ * sg_test_normalize Check sg_normalize on lists with empty entries
+ *
+ * @ret          Number of failed checks
+ *
+ * @note         Also checks that normalizing or destroying a list spliced
+ *               onto a destroyed one stops at the destroyed entries.
+ */
+extern int sg_test_normalize(void);
+
+/*
+ * sg_test_list  Check sg_split_at, sg_slice and sg_concat
+ *
+ * @ret          Number of failed checks
+ */
+extern int sg_test_list(void);
+
+#endif /* SG_TEST_H */
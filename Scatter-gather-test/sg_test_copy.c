@@ -0,0 +1,448 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sg_copy.h"
+#include "sg_csum.h"
+#include "sg_move.h"
+#include "sg_table.h"
+#include "sg_index.h"
+#include "sg_batch.h"
+#include "sg_test.h"
+
+#define SG_TEST_COPY_TRIALS 3000        // random lists copied by sg_test_copy
+#define SG_TEST_MOVE_TRIALS 3000        // random lists moved by sg_test_move
+#define SG_TEST_SPAN 8192               // bytes a random list may spread over
+#define SG_TEST_MAX_ENTRIES 1024        // entries of a random list
+#define SG_TEST_BATCH 4                 // descriptors of a random batch
+
+/*
+* Copy routine under test
+*
+* Note: gets the arguments of sg_copy and returns the bytes it copied
+*/
+typedef int (*sg_test_copy_fn)(sg_entry_t* src, sg_entry_t* dest,
+                               int src_offset, int count);
+
+typedef struct sg_test_routine_s {
+  const char* name;
+  sg_test_copy_fn copy;
+} sg_test_routine_t;
+
+static char sg_test_src_buf[2 * SG_TEST_SPAN];
+static char sg_test_dest_buf[SG_TEST_SPAN];
+static char sg_test_dest_init[SG_TEST_SPAN];
+static char sg_test_model[SG_TEST_SPAN];
+static sg_entry_t sg_test_src_entries[2][SG_TEST_MAX_ENTRIES];
+static sg_entry_t sg_test_dest_entries[SG_TEST_BATCH][SG_TEST_MAX_ENTRIES];
+
+/*
+* sg_test_reference Copy bytes as the original sg_copy did
+*
+* @in src       Source sg list
+* @in dest      Destination sg list
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+* @in src_base  First byte of the memory "src" maps
+* @in src_image Bytes read in place of those at src_base
+* @in dest_base First byte of the memory "dest" maps
+* @out dest_image Bytes written in place of those at dest_base
+* @inout crc    CRC32C updated over the bytes copied, may be NULL
+*
+* @ret          Actual number of bytes copied
+*
+* @note         A byte at a time: the source offset is found by skipping
+*               whole entries, the copy stops at the end of either list
+*               or at its first entry with a non-positive count.
+*/
+static int sg_test_reference(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count,
+                             const char* src_base, const char* src_image,
+                             const char* dest_base, char* dest_image, unsigned int* crc)
+{
+  sg_entry_t* src_curr = src;
+  sg_entry_t* dest_curr = dest;
+  int bytes_skipped = 0;
+  int offset_in_src_entry;
+  int offset_in_dest_entry = 0;
+  int bytes_copied = 0;
+  unsigned int c;
+  int i;
+
+  if (dest == NULL || src_offset < 0 || count <= 0) return 0;
+
+  while (src_curr != NULL && bytes_skipped + src_curr->count <= src_offset)
+  {
+    bytes_skipped += src_curr->count;
+    src_curr = src_curr->next;
+  }
+  if (src_curr == NULL) return 0;
+  offset_in_src_entry = src_offset - bytes_skipped;
+
+  while (bytes_copied < count && src_curr != NULL && dest_curr != NULL)
+  {
+    const char* p_src;
+    char* p_dest;
+
+    if (src_curr->count <= 0 || dest_curr->count <= 0) break;
+
+    p_src = (char*)phys_to_ptr(src_curr->paddr) + offset_in_src_entry;
+    p_dest = (char*)phys_to_ptr(dest_curr->paddr) + offset_in_dest_entry;
+    dest_image[p_dest - dest_base] = src_image[p_src - src_base];
+
+    if (crc != NULL)
+    {
+      // bitwise CRC32C, independent of the library's tables
+      c = ~*crc ^ (unsigned char)src_image[p_src - src_base];
+      for (i = 0; i < 8; i++)
+      {
+        c = (c >> 1) ^ (0x82f63b78u & (0u - (c & 1)));
+      }
+      *crc = ~c;
+    }
+
+    bytes_copied++;
+    if (++offset_in_src_entry == src_curr->count)
+    {
+      src_curr = src_curr->next;
+      offset_in_src_entry = 0;
+    }
+    if (++offset_in_dest_entry == dest_curr->count)
+    {
+      dest_curr = dest_curr->next;
+      offset_in_dest_entry = 0;
+    }
+  }
+
+  return bytes_copied;
+}
+
+/*
+* sg_test_build Map random fragments of a buffer
+*
+* @in entries   Entries to fill, SG_TEST_MAX_ENTRIES of them
+* @in buf       Buffer the fragments are taken from
+* @in span      Size of the buffer
+*
+* @ret          The list, never NULL
+*
+* @note         Either a page mapping of a random range, as sg_map makes,
+*               or fragments of 1 to 3 pages, some of a single aligned
+*               page, with random gaps between them. Some entries are
+*               emptied and the order of the entries is shuffled at
+*               random, the fragments never overlap.
+*/
+static sg_entry_t* sg_test_build(sg_entry_t* entries, char* buf, int span)
+{
+  int num_entries = 0;
+  int hole_pct = sg_test_range(0, 2) * 5;
+  int shuffle_pct = sg_test_range(0, 2) * 10;
+  int position;
+  int length;
+  int i;
+
+  if (sg_test_range(0, 2) == 0)
+  {
+    position = sg_test_range(0, PAGE_SIZE * 2);
+    length = sg_test_range(1, span - position);
+    num_entries = sg_map_into(buf + position, length, entries, SG_TEST_MAX_ENTRIES);
+  }
+  else
+  {
+    position = sg_test_range(0, PAGE_SIZE);
+    while (num_entries < SG_TEST_MAX_ENTRIES && position < span)
+    {
+      if (sg_test_range(0, 3) == 0)
+      {
+        // a whole aligned page, as the page kernels take
+        position = (position + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+        length = PAGE_SIZE;
+      }
+      else
+      {
+        length = sg_test_range(1, 3 * PAGE_SIZE);
+      }
+      if (length > span - position) length = span - position;
+      if (length <= 0) break;
+
+      init_entry(&entries[num_entries], ptr_to_phys(buf + position), length, NULL);
+      num_entries++;
+      position += length;
+      if (sg_test_range(0, 1) == 0) position += sg_test_range(1, PAGE_SIZE);
+    }
+  }
+
+  for (i = 0; i < num_entries; i++)
+  {
+    if ((int)(sg_test_rand() % 100) < hole_pct) entries[i].count = 0;
+  }
+
+  // each shuffled entry trades places with one at or after it
+  for (i = 0; i < num_entries - 1; i++)
+  {
+    if ((int)(sg_test_rand() % 100) < shuffle_pct)
+    {
+      int j = sg_test_range(i, num_entries - 1);
+      sg_entry_t tmp = entries[i];
+
+      entries[i] = entries[j];
+      entries[j] = tmp;
+    }
+  }
+
+  for (i = 0; i < num_entries - 1; i++)
+  {
+    entries[i].next = &entries[i + 1];
+  }
+  entries[num_entries - 1].next = NULL;
+
+  return &entries[0];
+}
+
+/*
+* sg_test_length Number of bytes of a list, empty entries included
+*
+* @in sg_list   A scatter-gather list
+*
+* @ret          Sum of the entry counts
+*/
+static int sg_test_length(const sg_entry_t* sg_list)
+{
+  int length = 0;
+
+  for (; sg_list != NULL; sg_list = sg_list->next)
+  {
+    length += sg_list->count;
+  }
+
+  return length;
+}
+
+static int sg_test_copy_fast(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count)
+{
+  return sg_copy_fast(src, dest, src_offset, count);
+}
+
+static int sg_test_copy64(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count)
+{
+  return (int)sg_copy64(src, dest, (size_t)src_offset, (size_t)count);
+}
+
+static int sg_test_copy_table(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count)
+{
+  sg_table_t* src_table = sg_table_from_list(src);
+  sg_table_t* dest_table = sg_table_from_list(dest);
+  int bytes_copied = 0;
+
+  if (src_table != NULL && dest_table != NULL)
+    bytes_copied = sg_copy_table(src_table, dest_table, src_offset, count);
+
+  sg_table_destroy(src_table);
+  sg_table_destroy(dest_table);
+
+  return bytes_copied;
+}
+
+static int sg_test_copy_indexed(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count)
+{
+  sg_index_t* index = sg_index_build(src);
+  int bytes_copied = 0;
+
+  if (index != NULL) bytes_copied = sg_copy_indexed(index, dest, src_offset, count);
+  sg_index_destroy(index);
+
+  return bytes_copied;
+}
+
+static const sg_test_routine_t sg_test_routines[] = {
+  { "sg_copy", sg_copy },
+  { "sg_copy_fast", sg_test_copy_fast },
+  { "sg_copy64", sg_test_copy64 },
+  { "sg_copy_nt", sg_copy_nt },
+  { "sg_move", sg_move },
+  { "sg_copy_table", sg_test_copy_table },
+  { "sg_copy_indexed", sg_test_copy_indexed }
+};
+
+#define SG_TEST_NUM_ROUTINES ((int)(sizeof(sg_test_routines) / sizeof(sg_test_routines[0])))
+
+/*
+* sg_test_args  Draw the offset and count of a copy
+*
+* @in src       Source sg list
+* @out src_offset Offset into source
+* @out count    Number of bytes to copy
+*
+* @note         Copies inside the first entry, reaching past either end
+*               and starting past the end of the list are all drawn.
+*/
+static void sg_test_args(sg_entry_t* src, int* src_offset, int* count)
+{
+  int length = sg_test_length(src);
+
+  if (sg_test_range(0, 3) == 0 && src->count > 0)
+  {
+    *src_offset = sg_test_range(0, src->count - 1);
+    *count = sg_test_range(1, src->count - *src_offset);
+  }
+  else
+  {
+    *src_offset = sg_test_range(0, length + PAGE_SIZE);
+    *count = sg_test_range(1, length + PAGE_SIZE);
+  }
+}
+
+/*
+* sg_test_copy_batch Compare sg_copy_batch against the reference
+*
+* @ret          Number of failed checks
+*/
+static int sg_test_copy_batch(void)
+{
+  sg_copy_desc_t descs[SG_TEST_BATCH];
+  int results[SG_TEST_BATCH];
+  int expected[SG_TEST_BATCH];
+  sg_entry_t* src[2];
+  int span = SG_TEST_SPAN / SG_TEST_BATCH;
+  int total = 0;
+  int failures = 0;
+  int i;
+
+  src[0] = sg_test_build(sg_test_src_entries[0], sg_test_src_buf, SG_TEST_SPAN);
+  src[1] = sg_test_build(sg_test_src_entries[1], sg_test_src_buf + SG_TEST_SPAN, SG_TEST_SPAN);
+  memcpy(sg_test_model, sg_test_dest_init, SG_TEST_SPAN);
+
+  // the destinations never overlap, so the copies may run in any order
+  for (i = 0; i < SG_TEST_BATCH; i++)
+  {
+    descs[i].src = src[sg_test_range(0, 1)];
+    descs[i].dest = sg_test_build(sg_test_dest_entries[i], sg_test_dest_buf + i * span, span);
+    sg_test_args(descs[i].src, &descs[i].src_offset, &descs[i].count);
+    expected[i] = sg_test_reference(descs[i].src, descs[i].dest, descs[i].src_offset,
+                                    descs[i].count, sg_test_src_buf, sg_test_src_buf,
+                                    sg_test_dest_buf, sg_test_model, NULL);
+    total += expected[i];
+  }
+
+  memcpy(sg_test_dest_buf, sg_test_dest_init, SG_TEST_SPAN);
+  SG_TEST_CHECK(sg_copy_batch(descs, SG_TEST_BATCH, results) == total);
+  for (i = 0; i < SG_TEST_BATCH; i++)
+  {
+    SG_TEST_CHECK(results[i] == expected[i]);
+  }
+  SG_TEST_CHECK(memcmp(sg_test_dest_buf, sg_test_model, SG_TEST_SPAN) == 0);
+
+  return failures;
+}
+
+/*
+* sg_test_copy  Compare every copy routine against the reference sg_copy
+*
+* @ret          Number of failed checks
+*/
+int sg_test_copy(void)
+{
+  size_t nt_threshold = sg_get_nt_threshold();
+  int failures = 0;
+  int trial;
+  int i;
+
+  for (i = 0; i < (int)sizeof(sg_test_src_buf); i++)
+  {
+    sg_test_src_buf[i] = (char)sg_test_rand();
+  }
+  for (i = 0; i < SG_TEST_SPAN; i++)
+  {
+    sg_test_dest_init[i] = (char)sg_test_rand();
+  }
+
+  for (trial = 0; trial < SG_TEST_COPY_TRIALS; trial++)
+  {
+    sg_entry_t* src = sg_test_build(sg_test_src_entries[0], sg_test_src_buf, SG_TEST_SPAN);
+    sg_entry_t* dest = sg_test_build(sg_test_dest_entries[0], sg_test_dest_buf, SG_TEST_SPAN);
+    unsigned int expected_crc = 0;
+    unsigned int crc = 0;
+    int src_offset;
+    int count;
+    int expected;
+    int r;
+
+    // every copy long enough streams, not only the large ones
+    sg_set_nt_threshold(sg_test_range(0, 1) == 0 ? 0 : nt_threshold);
+
+    sg_test_args(src, &src_offset, &count);
+    memcpy(sg_test_model, sg_test_dest_init, SG_TEST_SPAN);
+    expected = sg_test_reference(src, dest, src_offset, count, sg_test_src_buf,
+                                 sg_test_src_buf, sg_test_dest_buf, sg_test_model,
+                                 &expected_crc);
+
+    for (r = 0; r < SG_TEST_NUM_ROUTINES; r++)
+    {
+      int bytes_copied;
+
+      memcpy(sg_test_dest_buf, sg_test_dest_init, SG_TEST_SPAN);
+      bytes_copied = sg_test_routines[r].copy(src, dest, src_offset, count);
+      if (bytes_copied != expected ||
+          memcmp(sg_test_dest_buf, sg_test_model, SG_TEST_SPAN) != 0)
+      {
+        if (failures < 10)
+          fprintf(stderr, "%s: offset %d count %d copied %d instead of %d\n",
+                  sg_test_routines[r].name, src_offset, count, bytes_copied, expected);
+        failures++;
+      }
+    }
+
+    memcpy(sg_test_dest_buf, sg_test_dest_init, SG_TEST_SPAN);
+    SG_TEST_CHECK(sg_copy_csum(src, dest, src_offset, count, &crc) == expected);
+    SG_TEST_CHECK(crc == expected_crc);
+    SG_TEST_CHECK(memcmp(sg_test_dest_buf, sg_test_model, SG_TEST_SPAN) == 0);
+
+    failures += sg_test_copy_batch();
+  }
+
+  sg_set_nt_threshold(nt_threshold);
+
+  return failures;
+}
+
+/*
+* sg_test_move  Check sg_move on lists mapping overlapping memory
+*
+* @ret          Number of failed checks
+*
+* @note         Both lists map the same buffer, or are the same list. The
+*               reference reads a snapshot of the buffer taken before the
+*               move, as the bytes "src" held before the call.
+*/
+int sg_test_move(void)
+{
+  static char snapshot[SG_TEST_SPAN];
+  int failures = 0;
+  int trial;
+  int i;
+
+  for (trial = 0; trial < SG_TEST_MOVE_TRIALS; trial++)
+  {
+    sg_entry_t* src = sg_test_build(sg_test_src_entries[0], sg_test_dest_buf, SG_TEST_SPAN);
+    sg_entry_t* dest = src;
+    int src_offset;
+    int count;
+    int expected;
+
+    if (sg_test_range(0, 3) != 0)
+      dest = sg_test_build(sg_test_dest_entries[0], sg_test_dest_buf, SG_TEST_SPAN);
+
+    for (i = 0; i < SG_TEST_SPAN; i++)
+    {
+      sg_test_dest_buf[i] = (char)sg_test_rand();
+    }
+    memcpy(snapshot, sg_test_dest_buf, SG_TEST_SPAN);
+    memcpy(sg_test_model, sg_test_dest_buf, SG_TEST_SPAN);
+
+    sg_test_args(src, &src_offset, &count);
+    expected = sg_test_reference(src, dest, src_offset, count, sg_test_dest_buf, snapshot,
+                                 sg_test_dest_buf, sg_test_model, NULL);
+
+    SG_TEST_CHECK(sg_move(src, dest, src_offset, count) == expected);
+    SG_TEST_CHECK(memcmp(sg_test_dest_buf, sg_test_model, SG_TEST_SPAN) == 0);
+  }
+
+  return failures;
+}
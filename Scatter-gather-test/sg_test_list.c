@@ -0,0 +1,313 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sg_copy.h"
+#include "sg_alloc.h"
+#include "sg_list.h"
+#include "sg_normalize.h"
+#include "sg_table.h"
+#include "sg_test.h"
+
+#define SG_TEST_LIST_TRIALS 2000        // random lists built by each suite
+#define SG_TEST_LIST_SPAN 8192          // bytes a random list may spread over
+#define SG_TEST_LIST_MAX_ENTRIES 256    // entries of a random list
+
+static char sg_test_list_buf[SG_TEST_LIST_SPAN];
+static char sg_test_list_flat[SG_TEST_LIST_SPAN];
+static char sg_test_list_expected[SG_TEST_LIST_SPAN];
+
+/*
+* sg_test_gather Read the bytes of a list, skipping its empty entries
+*
+* @in sg_list   A scatter-gather list
+* @out buf      Receives the bytes, SG_TEST_LIST_SPAN at most
+*
+* @ret          Number of bytes read
+*
+* @note         Stops before an entry marked SG_ENTRY_FREED.
+*/
+static int sg_test_gather(const sg_entry_t* sg_list, char* buf)
+{
+  int length = 0;
+
+  for (; sg_list != NULL && sg_list->count >= 0; sg_list = sg_list->next)
+  {
+    memcpy(buf + length, phys_to_ptr(sg_list->paddr), sg_list->count);
+    length += sg_list->count;
+  }
+
+  return length;
+}
+
+/*
+* sg_test_fragments Build a list of random fragments with empty entries
+*
+* @in buf       Buffer the fragments are taken from
+* @in span      Size of the buffer
+* @out num_entries Number of entries in the list
+*
+* @ret          A list from sg_default_allocator, NULL on failure
+*
+* @note         Fragments often follow each other in memory so that
+*               sg_normalize has entries to merge, and a random share of
+*               the entries, the head included, are empty.
+*/
+static sg_entry_t* sg_test_fragments(char* buf, int span, int* num_entries)
+{
+  sg_entry_t* sg_list;
+  sg_entry_t* list_curr;
+  int position = sg_test_range(0, PAGE_SIZE);
+  int n = sg_test_range(1, SG_TEST_LIST_MAX_ENTRIES);
+  int length;
+
+  sg_list = sg_default_allocator.alloc(sg_default_allocator.ctx, n);
+  if (sg_list == NULL) return NULL;
+
+  for (list_curr = sg_list; list_curr != NULL; list_curr = list_curr->next)
+  {
+    length = sg_test_range(0, 3) == 0 ? 0 : sg_test_range(1, PAGE_SIZE);
+    if (length > span - position) length = 0;
+    init_entry(list_curr, ptr_to_phys(buf + position), length, list_curr->next);
+    position += length;
+    if (sg_test_range(0, 3) == 0 && position < span) position++;
+  }
+  *num_entries = n;
+
+  return sg_list;
+}
+
+/*
+* sg_test_normalize_spliced Normalize and destroy a list spliced onto a
+*               destroyed one
+*
+* @in use_header Non-zero to destroy the other list with sg_list_destroy,
+*               which only marks its head, zero for sg_destroy_with
+*
+* @ret          Number of failed checks
+*
+* @note         The destroyed list comes from an arena, so its entries
+*               can still be read once it is destroyed.
+*/
+static int sg_test_normalize_spliced(int use_header)
+{
+  sg_arena_t arena;
+  sg_list_t destroyed;
+  sg_entry_t* sg_list;
+  sg_entry_t* tail;
+  sg_entry_t* head;
+  int num_entries;
+  int entries_before;
+  int length;
+  int failures = 0;
+
+  if (sg_arena_init(&arena, SG_TEST_LIST_SPAN / PAGE_SIZE) != 0)
+  {
+    SG_TEST_CHECK(0);
+    return failures;
+  }
+  if (sg_list_map(&destroyed, sg_test_list_buf + SG_TEST_LIST_SPAN / 2,
+                  SG_TEST_LIST_SPAN / 2, NULL, &arena.allocator) != 0)
+  {
+    SG_TEST_CHECK(0);
+    sg_arena_free(&arena);
+    return failures;
+  }
+
+  sg_list = sg_test_fragments(sg_test_list_buf, SG_TEST_LIST_SPAN / 2, &num_entries);
+  SG_TEST_CHECK(sg_list != NULL);
+  if (sg_list == NULL)
+  {
+    sg_arena_free(&arena);
+    return failures;
+  }
+  length = sg_test_gather(sg_list, sg_test_list_expected);
+
+  head = destroyed.head;
+  for (tail = sg_list; tail->next != NULL; tail = tail->next);
+  tail->next = head;
+
+  if (use_header)
+  {
+    sg_list_destroy(&destroyed);
+  }
+  else
+  {
+    sg_destroy_with(destroyed.head, &arena.allocator);
+  }
+  SG_TEST_CHECK(head->count == SG_ENTRY_FREED);
+
+  // neither walk may reach into the destroyed list
+  SG_TEST_CHECK(sg_test_gather(sg_list, sg_test_list_flat) == length);
+  sg_normalize(sg_list, NULL, NULL, &entries_before);
+  SG_TEST_CHECK(entries_before == num_entries);
+  SG_TEST_CHECK(head->count == SG_ENTRY_FREED);
+  SG_TEST_CHECK(sg_test_gather(sg_list, sg_test_list_flat) == length);
+  SG_TEST_CHECK(memcmp(sg_test_list_flat, sg_test_list_expected, length) == 0);
+
+  // the normalized list may end at another entry
+  for (tail = sg_list; tail->next != NULL; tail = tail->next);
+  tail->next = head;
+  sg_destroy(sg_list);
+  SG_TEST_CHECK(head->count == SG_ENTRY_FREED);
+  sg_arena_free(&arena);
+
+  return failures;
+}
+
+/*
+* sg_test_normalize Check sg_normalize on lists with empty entries
+*
+* @ret          Number of failed checks
+*/
+int sg_test_normalize(void)
+{
+  sg_entry_t* sg_list;
+  sg_entry_t* list_curr;
+  sg_table_t* table;
+  int num_entries;
+  int entries_before;
+  int counted;
+  int num_after;
+  int length;
+  int failures = 0;
+  int trial;
+  int i;
+
+  for (i = 0; i < SG_TEST_LIST_SPAN; i++)
+  {
+    sg_test_list_buf[i] = (char)sg_test_rand();
+  }
+
+  for (trial = 0; trial < SG_TEST_LIST_TRIALS; trial++)
+  {
+    sg_list = sg_test_fragments(sg_test_list_buf, SG_TEST_LIST_SPAN, &num_entries);
+    SG_TEST_CHECK(sg_list != NULL);
+    if (sg_list == NULL) break;
+    length = sg_test_gather(sg_list, sg_test_list_expected);
+
+    counted = sg_normalize_count(sg_list, NULL, &entries_before);
+    SG_TEST_CHECK(entries_before == num_entries);
+    table = sg_normalize_table(sg_list, NULL, NULL);
+    SG_TEST_CHECK(table == NULL ? counted == 0 : table->num_entries == counted);
+    sg_table_destroy(table);
+
+    // empty entries are dropped, the bytes stay in order
+    num_after = sg_normalize(sg_list, NULL, NULL, &entries_before);
+    SG_TEST_CHECK(num_after == counted);
+    SG_TEST_CHECK(entries_before == num_entries);
+    SG_TEST_CHECK(sg_test_gather(sg_list, sg_test_list_flat) == length);
+    SG_TEST_CHECK(memcmp(sg_test_list_flat, sg_test_list_expected, length) == 0);
+
+    i = 0;
+    for (list_curr = sg_list; list_curr != NULL; list_curr = list_curr->next)
+    {
+      SG_TEST_CHECK(list_curr->count > 0 || (num_after == 0 && list_curr == sg_list));
+      i++;
+    }
+    SG_TEST_CHECK(i == (num_after == 0 ? 1 : num_after));
+
+    // a second pass finds nothing left to merge
+    SG_TEST_CHECK(sg_normalize_count(sg_list, NULL, NULL) == num_after);
+    sg_destroy(sg_list);
+
+    failures += sg_test_normalize_spliced(trial % 2);
+  }
+
+  return failures;
+}
+
+/*
+* sg_test_list_check Compare a range of a list with the buffer it maps
+*
+* @in list      A list or view
+* @in buf       Bytes expected at offset 0 of the list
+*
+* @ret          Non-zero if the list holds those bytes
+*/
+static int sg_test_list_check(const sg_list_t* list, const char* buf)
+{
+  sg_list_t flat;
+  size_t bytes_copied;
+
+  if (list->length == 0) return list->head == NULL;
+  if (sg_list_map(&flat, sg_test_list_flat, list->length, NULL, NULL) != 0) return 0;
+
+  memset(sg_test_list_flat, 0, list->length);
+  bytes_copied = sg_list_copy(list, 0, &flat, list->length);
+  sg_list_destroy(&flat);
+
+  return bytes_copied == list->length &&
+         memcmp(sg_test_list_flat, buf, list->length) == 0;
+}
+
+/*
+* sg_test_list  Check sg_split_at, sg_slice and sg_concat
+*
+* @ret          Number of failed checks
+*
+* @note         A buffer is mapped with a random geometry, split at random
+*               offsets, sliced at random ranges and concatenated back,
+*               each piece must hold its own range of the buffer.
+*/
+int sg_test_list(void)
+{
+  sg_list_t list;
+  sg_list_t rest;
+  sg_list_t slice;
+  sg_list_t view_rest;
+  sg_geom_t geom;
+  size_t length;
+  size_t offset;
+  size_t slice_offset;
+  size_t slice_length;
+  int failures = 0;
+  int trial;
+  int i;
+
+  for (i = 0; i < SG_TEST_LIST_SPAN; i++)
+  {
+    sg_test_list_buf[i] = (char)sg_test_rand();
+  }
+
+  for (trial = 0; trial < SG_TEST_LIST_TRIALS; trial++)
+  {
+    SG_TEST_CHECK(sg_geom_init(&geom, sg_test_range(1, 4 * PAGE_SIZE)) == 0);
+    length = sg_test_range(1, SG_TEST_LIST_SPAN - PAGE_SIZE);
+    if (sg_list_map(&list, sg_test_list_buf, length, &geom, NULL) != 0)
+    {
+      SG_TEST_CHECK(0);
+      continue;
+    }
+
+    // slices share the entries, a slice of a slice as well
+    slice_offset = sg_test_range(0, (int)length);
+    slice_length = sg_test_range(0, (int)(length - slice_offset));
+    SG_TEST_CHECK(sg_slice(&list, slice_offset, slice_length, &slice) == 0);
+    SG_TEST_CHECK(sg_test_list_check(&slice, sg_test_list_buf + slice_offset));
+    if (slice_length > 0)
+    {
+      offset = sg_test_range(0, (int)slice_length);
+      SG_TEST_CHECK(sg_split_at(&slice, offset, &view_rest) == 0);
+      SG_TEST_CHECK(slice.length == offset && view_rest.length == slice_length - offset);
+      SG_TEST_CHECK(sg_test_list_check(&slice, sg_test_list_buf + slice_offset));
+      SG_TEST_CHECK(sg_test_list_check(&view_rest, sg_test_list_buf + slice_offset + offset));
+    }
+    SG_TEST_CHECK(sg_slice(&list, 0, length + 1, &slice) != 0);
+
+    // splits inside an entry take a new one, at a boundary they do not
+    offset = sg_test_range(0, (int)length);
+    SG_TEST_CHECK(sg_split_at(&list, offset, &rest) == 0);
+    SG_TEST_CHECK(list.length == offset && rest.length == length - offset);
+    SG_TEST_CHECK(sg_test_list_check(&list, sg_test_list_buf));
+    SG_TEST_CHECK(sg_test_list_check(&rest, sg_test_list_buf + offset));
+    SG_TEST_CHECK(list.tail == NULL || list.tail->next == NULL);
+
+    SG_TEST_CHECK(sg_concat(&list, &rest) == 0);
+    SG_TEST_CHECK(list.length == length && rest.head == NULL);
+    SG_TEST_CHECK(sg_test_list_check(&list, sg_test_list_buf));
+
+    sg_list_destroy(&list);
+    sg_list_destroy(&rest);
+  }
+
+  return failures;
+}
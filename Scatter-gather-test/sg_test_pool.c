@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sg_copy.h"
+#include "sg_alloc.h"
+#include "sg_stats.h"
+#include "sg_thread.h"
+#include "sg_test.h"
+
+#define SG_TEST_POOL_THREADS 4          // threads mapping and destroying lists
+#define SG_TEST_POOL_ROUNDS 2000        // lists mapped by each thread
+#define SG_TEST_POOL_MAILBOX 8          // lists waiting for a thread to destroy them
+#define SG_TEST_POOL_MAX_LENGTH (64 * 1024)
+
+/*
+* List handed to another thread
+*/
+typedef struct sg_test_mail_s {
+  sg_entry_t* sg_list;
+  char* buf;
+  int length;
+} sg_test_mail_t;
+
+/*
+* Lists a thread destroys on behalf of the thread before it
+*/
+typedef struct sg_test_mailbox_s {
+  sg_mutex_t lock;
+  sg_test_mail_t mail[SG_TEST_POOL_MAILBOX];
+  int num_mail;
+} sg_test_mailbox_t;
+
+typedef struct sg_test_worker_s {
+  sg_test_mailbox_t* inbox;       // lists this thread destroys
+  sg_test_mailbox_t* outbox;      // lists this thread hands over
+  unsigned int seed;
+  int failures;
+} sg_test_worker_t;
+
+// only the addresses are mapped, the bytes are never touched
+static char sg_test_pool_buf[SG_TEST_POOL_MAX_LENGTH + PAGE_SIZE];
+
+/*
+* sg_test_pool_check Tell whether a list still maps what sg_map mapped
+*
+* @in sg_list   A list made by sg_map
+* @in buf       Buffer passed to sg_map
+* @in length    Length passed to sg_map
+*
+* @ret          Non-zero if the entries map the buffer in order
+*
+* @note         An entry handed to two lists at once is rewritten by the
+*               other one, and breaks the mapping of this one.
+*/
+static int sg_test_pool_check(const sg_entry_t* sg_list, const char* buf, int length)
+{
+  int position = 0;
+
+  for (; sg_list != NULL; sg_list = sg_list->next)
+  {
+    if (sg_list->count <= 0 || sg_list->count > PAGE_SIZE) return 0;
+    if ((char*)phys_to_ptr(sg_list->paddr) != buf + position) return 0;
+    position += sg_list->count;
+  }
+
+  return position == length;
+}
+
+/*
+* sg_test_pool_thread Map lists, check them and give half of them away
+*
+* @in arg       The sg_test_worker_t of the thread
+*/
+static sg_thread_ret_t SG_THREAD_CALL sg_test_pool_thread(void* arg)
+{
+  sg_test_worker_t* worker = (sg_test_worker_t*)arg;
+  sg_test_mail_t mail;
+  sg_test_mail_t received[SG_TEST_POOL_MAILBOX];
+  int num_received;
+  int round;
+  int i;
+
+  for (round = 0; round < SG_TEST_POOL_ROUNDS; round++)
+  {
+    worker->seed = worker->seed * 1103515245 + 12345;
+    mail.buf = sg_test_pool_buf + (worker->seed >> 8) % PAGE_SIZE;
+    worker->seed = worker->seed * 1103515245 + 12345;
+    // mostly short lists, now and then one of thousands of entries
+    if ((worker->seed >> 8) % 16 == 0)
+      mail.length = 1 + (int)((worker->seed >> 12) % SG_TEST_POOL_MAX_LENGTH);
+    else
+      mail.length = 1 + (int)((worker->seed >> 12) % (16 * PAGE_SIZE));
+
+    mail.sg_list = sg_map(mail.buf, mail.length);
+    if (!sg_test_pool_check(mail.sg_list, mail.buf, mail.length)) worker->failures++;
+
+    sg_mutex_lock(&worker->outbox->lock);
+    if (round % 2 == 0 && worker->outbox->num_mail < SG_TEST_POOL_MAILBOX)
+    {
+      worker->outbox->mail[worker->outbox->num_mail++] = mail;
+      mail.sg_list = NULL;
+    }
+    sg_mutex_unlock(&worker->outbox->lock);
+    if (mail.sg_list != NULL)
+    {
+      if (!sg_test_pool_check(mail.sg_list, mail.buf, mail.length)) worker->failures++;
+      sg_destroy(mail.sg_list);
+    }
+
+    // lists are checked again by the thread destroying them
+    sg_mutex_lock(&worker->inbox->lock);
+    num_received = worker->inbox->num_mail;
+    memcpy(received, worker->inbox->mail, num_received * sizeof(sg_test_mail_t));
+    worker->inbox->num_mail = 0;
+    sg_mutex_unlock(&worker->inbox->lock);
+    for (i = 0; i < num_received; i++)
+    {
+      if (!sg_test_pool_check(received[i].sg_list, received[i].buf, received[i].length))
+        worker->failures++;
+      sg_destroy(received[i].sg_list);
+    }
+  }
+
+  return 0;
+}
+
+/*
+* sg_test_pool  Check the default allocator across threads
+*
+* @ret          Number of failed checks
+*/
+int sg_test_pool(void)
+{
+  sg_test_mailbox_t mailboxes[SG_TEST_POOL_THREADS];
+  sg_test_worker_t workers[SG_TEST_POOL_THREADS];
+  sg_thread_t threads[SG_TEST_POOL_THREADS];
+  sg_stats_t stats;
+  sg_entry_t* sg_list;
+  int failures = 0;
+  int i;
+  int j;
+
+  for (i = 0; i < SG_TEST_POOL_THREADS; i++)
+  {
+    SG_TEST_CHECK(sg_mutex_init(&mailboxes[i].lock) == 0);
+    mailboxes[i].num_mail = 0;
+  }
+
+  // thread i destroys the lists of thread i - 1
+  for (i = 0; i < SG_TEST_POOL_THREADS; i++)
+  {
+    workers[i].inbox = &mailboxes[i];
+    workers[i].outbox = &mailboxes[(i + 1) % SG_TEST_POOL_THREADS];
+    workers[i].seed = sg_test_rand();
+    workers[i].failures = 0;
+    SG_TEST_CHECK(sg_thread_create(&threads[i], sg_test_pool_thread, &workers[i]) == 0);
+  }
+  for (i = 0; i < SG_TEST_POOL_THREADS; i++)
+  {
+    sg_thread_join(threads[i]);
+    SG_TEST_CHECK(workers[i].failures == 0);
+  }
+
+  // lists left behind by threads that exited first
+  for (i = 0; i < SG_TEST_POOL_THREADS; i++)
+  {
+    for (j = 0; j < mailboxes[i].num_mail; j++)
+    {
+      SG_TEST_CHECK(sg_test_pool_check(mailboxes[i].mail[j].sg_list, mailboxes[i].mail[j].buf,
+                                       mailboxes[i].mail[j].length));
+      sg_destroy(mailboxes[i].mail[j].sg_list);
+    }
+    sg_mutex_destroy(&mailboxes[i].lock);
+  }
+
+  // the pools the threads flushed on exit are drawn from again
+  sg_list = sg_map(sg_test_pool_buf, SG_TEST_POOL_MAX_LENGTH);
+  SG_TEST_CHECK(sg_test_pool_check(sg_list, sg_test_pool_buf, SG_TEST_POOL_MAX_LENGTH));
+  sg_destroy(sg_list);
+
+  if (sg_stats_enabled())
+  {
+    sg_stats_snapshot(&stats);
+    SG_TEST_CHECK(stats.entries_allocated == stats.entries_freed);
+  }
+
+  return failures;
+}
@@ -0,0 +1,630 @@
+#include <stdlib.h>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+#include "sg_alloc.h"
+#include "sg_port.h"
+#include "sg_stats.h"
+#include "sg_thread.h"
+
+/*
+* Per-thread pool of free entries
+*
+* Note: free entries are linked through "next". A pool holding more than
+* SG_POOL_MAGAZINE_ENTRIES entries gives back the slabs all of whose
+* entries it holds, then hands batches to the depot while it has room.
+* The slabs it cannot give back, because some of their entries are in
+* use or sit elsewhere, are only looked at again once the pool has
+* doubled, so a release stays O(1) amortized. An empty pool takes
+* batches from the depot, then the entries of exited threads, before it
+* allocates new slabs. The pool of an exiting thread is flushed
+*/
+typedef struct sg_pool_s {
+  sg_entry_t* free_list;
+  int free_count;
+  int trim_at;                    // free_count above which slabs are freed
+  int registered;                 // non-zero once the exit callback is set
+} sg_pool_t;
+
+static SG_THREAD_LOCAL sg_pool_t sg_pool;
+
+/*
+* Slabs
+*
+* Note: a slab is a block of SG_POOL_SLAB_BYTES aligned on its own size,
+* filled with entries, so the slab of an entry is found by masking its
+* address. Entries are only handed out by slabs
+*/
+#define SG_SLAB_ENTRIES ((int)(SG_POOL_SLAB_BYTES / sizeof(sg_entry_t)))
+#define SG_SLAB_OF(entry) ((size_t)(entry) & ~(size_t)(SG_POOL_SLAB_BYTES - 1))
+
+// slabs allocated and not yet given back, by all threads
+static volatile long sg_slabs_live;
+
+// pools trim once they hold a batch more than their magazine
+#define SG_POOL_TRIM_ENTRIES (SG_POOL_MAGAZINE_ENTRIES + SG_POOL_BATCH_ENTRIES)
+
+/*
+* Depot of free entries shared by all threads
+*
+* Note: each slot is empty (NULL), claimed by a thread filling it
+* (SG_DEPOT_BUSY) or holds a chain of exactly SG_POOL_BATCH_ENTRIES free
+* entries. Slots are claimed, filled and emptied with a single CAS each,
+* and a CAS never depends on the content of the batch it moves, so the
+* depot is lock-free and free of ABA problems. sg_depot_used counts the
+* slots that are not empty, a full depot is noticed without a scan.
+* Threads start scanning at different slots to spread the CAS traffic
+*/
+static sg_entry_t* volatile sg_depot[SG_POOL_DEPOT_SLOTS];
+static volatile long sg_depot_used;
+
+// marks a slot whose batch is still being cut off a pool
+static sg_entry_t sg_depot_busy;
+#define SG_DEPOT_BUSY (&sg_depot_busy)
+
+// slot after the one the calling thread last used, 0 before its first scan
+static SG_THREAD_LOCAL unsigned int sg_depot_hint;
+
+/*
+* sg_depot_start Pick the slot the calling thread starts scanning at
+*
+* @ret          A slot index
+*/
+static unsigned int sg_depot_start(void)
+{
+  // the first scan of a thread starts at a slot derived from its pool's
+  // address, which differs between threads
+  if (sg_depot_hint == 0)
+  {
+    sg_depot_hint = (unsigned int)(((size_t)&sg_pool >> 6) % SG_POOL_DEPOT_SLOTS) + 1;
+  }
+
+  return sg_depot_hint - 1;
+}
+
+/*
+* sg_depot_put  Move one batch from the calling thread's pool to the depot
+*
+* @ret          0 on success, -1 if the pool is short of a batch or the
+*               depot is full
+*
+* @note         A slot is claimed before the batch is walked, a full depot
+*               costs a single read.
+*/
+static int sg_depot_put(void)
+{
+  sg_entry_t* head;
+  sg_entry_t* tail;
+  unsigned int start;
+  unsigned int i;
+  int j;
+
+  if (sg_pool.free_count < SG_POOL_BATCH_ENTRIES) return -1;
+  if (SG_ATOMIC_LOAD(&sg_depot_used) >= SG_POOL_DEPOT_SLOTS) return -1;
+  start = sg_depot_start();
+
+  for (i = 0; i < SG_POOL_DEPOT_SLOTS; i++)
+  {
+    unsigned int slot = (start + i) % SG_POOL_DEPOT_SLOTS;
+
+    if (SG_ATOMIC_LOAD(&sg_depot[slot]) != NULL) continue;
+    if (!SG_CAS_PTR(&sg_depot[slot], (sg_entry_t*)NULL, SG_DEPOT_BUSY)) continue;
+    SG_ATOMIC_ADD(&sg_depot_used, 1);
+
+    // the slot is ours, cut the batch off the pool and publish it
+    head = sg_pool.free_list;
+    tail = head;
+    for (j = 1; j < SG_POOL_BATCH_ENTRIES; j++)
+    {
+      tail = tail->next;
+    }
+    sg_pool.free_list = tail->next;
+    sg_pool.free_count -= SG_POOL_BATCH_ENTRIES;
+    tail->next = NULL;
+    SG_CAS_PTR(&sg_depot[slot], SG_DEPOT_BUSY, head);
+
+    sg_depot_hint = slot + 1;
+    SG_STAT_ADD(depot_puts, 1);
+    return 0;
+  }
+
+  return -1;
+}
+
+/*
+* sg_depot_get  Move one batch from the depot to the calling thread's pool
+*
+* @ret          0 on success, -1 if the depot is empty
+*/
+static int sg_depot_get(void)
+{
+  unsigned int start;
+  unsigned int i;
+
+  if (SG_ATOMIC_LOAD(&sg_depot_used) <= 0) return -1;
+  start = sg_depot_start();
+
+  for (i = 0; i < SG_POOL_DEPOT_SLOTS; i++)
+  {
+    unsigned int slot = (start + i) % SG_POOL_DEPOT_SLOTS;
+    sg_entry_t* head = SG_ATOMIC_LOAD(&sg_depot[slot]);
+    sg_entry_t* tail;
+    int j;
+
+    if (head == NULL || head == SG_DEPOT_BUSY) continue;
+    if (!SG_CAS_PTR(&sg_depot[slot], head, (sg_entry_t*)NULL)) continue;
+    SG_ATOMIC_ADD(&sg_depot_used, -1);
+
+    // the batch now belongs to this thread alone
+    tail = head;
+    for (j = 1; j < SG_POOL_BATCH_ENTRIES; j++)
+    {
+      tail = tail->next;
+    }
+    tail->next = sg_pool.free_list;
+    sg_pool.free_list = head;
+    sg_pool.free_count += SG_POOL_BATCH_ENTRIES;
+    sg_depot_hint = slot + 1;
+    SG_STAT_ADD(depot_gets, 1);
+
+    return 0;
+  }
+
+  return -1;
+}
+
+/*
+* Entries of exited threads
+*
+* Note: a lock-free stack of chains, pushed by sg_pool_flush and taken
+* whole by pools running short. Taking everything at once is immune to
+* ABA problems
+*/
+static sg_entry_t* volatile sg_orphans;
+
+/*
+* sg_orphans_put Push a chain of free entries on the orphan stack
+*
+* @in head      First entry of the chain
+* @in tail      Last entry of the chain
+*/
+static void sg_orphans_put(sg_entry_t* head, sg_entry_t* tail)
+{
+  sg_entry_t* top;
+
+  do
+  {
+    top = SG_ATOMIC_LOAD(&sg_orphans);
+    tail->next = top;
+  } while (!SG_CAS_PTR(&sg_orphans, top, head));
+}
+
+/*
+* sg_orphans_get Move every orphaned entry to the calling thread's pool
+*
+* @ret          0 on success, -1 if there are none
+*/
+static int sg_orphans_get(void)
+{
+  sg_entry_t* head;
+  sg_entry_t* tail;
+  int n = 1;
+
+  do
+  {
+    head = SG_ATOMIC_LOAD(&sg_orphans);
+    if (head == NULL) return -1;
+  } while (!SG_CAS_PTR(&sg_orphans, head, (sg_entry_t*)NULL));
+
+  for (tail = head; tail->next != NULL; tail = tail->next)
+  {
+    n++;
+  }
+  tail->next = sg_pool.free_list;
+  sg_pool.free_list = head;
+  sg_pool.free_count += n;
+
+  return 0;
+}
+
+static sg_thread_key_t sg_pool_key;
+static int sg_pool_key_valid;
+static sg_once_t sg_pool_key_once = SG_ONCE_INIT;
+
+static void SG_THREAD_KEY_CALL sg_pool_exit(void* pool)
+{
+  (void)pool;
+  sg_pool.registered = 0;
+  sg_pool_flush();
+}
+
+static void sg_pool_key_create(void)
+{
+  sg_pool_key_valid = sg_thread_key_create(&sg_pool_key, sg_pool_exit) == 0;
+}
+
+/*
+* sg_pool_register Have the calling thread's pool flushed when it exits
+*/
+static void sg_pool_register(void)
+{
+  sg_pool.registered = 1;
+  if (sg_pool.trim_at == 0) sg_pool.trim_at = SG_POOL_TRIM_ENTRIES;
+
+  sg_once(&sg_pool_key_once, sg_pool_key_create);
+  if (sg_pool_key_valid) sg_thread_key_set(sg_pool_key, &sg_pool);
+}
+
+/*
+* sg_slab_alloc Allocate a slab aligned on its own size
+*
+* @ret          The slab, NULL on failure
+*/
+static sg_entry_t* sg_slab_alloc(void)
+{
+  void* slab;
+
+#if defined(_WIN32)
+  slab = _aligned_malloc(SG_POOL_SLAB_BYTES, SG_POOL_SLAB_BYTES);
+#else
+  if (posix_memalign(&slab, SG_POOL_SLAB_BYTES, SG_POOL_SLAB_BYTES) != 0) slab = NULL;
+#endif
+
+  if (slab != NULL) SG_ATOMIC_ADD(&sg_slabs_live, 1);
+  return (sg_entry_t*)slab;
+}
+
+static void sg_slab_free(void* slab)
+{
+#if defined(_WIN32)
+  _aligned_free(slab);
+#else
+  free(slab);
+#endif
+  SG_ATOMIC_ADD(&sg_slabs_live, -1);
+  SG_STAT_ADD(slabs_freed, 1);
+}
+
+/*
+* sg_pool_refill Add new slabs to the calling thread's pool
+*
+* @in min_entries Minimum number of entries to add
+*
+* @ret          0 on success, -1 on failure
+*/
+static int sg_pool_refill(int min_entries)
+{
+  int added = 0;
+
+  while (added < min_entries)
+  {
+    sg_entry_t* slab = sg_slab_alloc();
+    int i;
+
+    if (slab == NULL) return -1;
+    SG_STAT_ADD(slab_refills, 1);
+
+    // link the slab in address order so chains taken from it are walked
+    // sequentially
+    for (i = 0; i < SG_SLAB_ENTRIES - 1; i++)
+    {
+      slab[i].next = &slab[i + 1];
+    }
+    slab[SG_SLAB_ENTRIES - 1].next = sg_pool.free_list;
+
+    sg_pool.free_list = slab;
+    sg_pool.free_count += SG_SLAB_ENTRIES;
+    added += SG_SLAB_ENTRIES;
+  }
+
+  return 0;
+}
+
+/*
+* Number of free entries of one slab, counted by sg_pool_trim
+*/
+typedef struct sg_slab_count_s {
+  size_t slab;                    // slab address, 0 for an unused slot
+  int count;                      // free entries, -1 once the slab is picked
+} sg_slab_count_t;
+
+/*
+* sg_slab_find  Find the slot of a slab in an open-addressing table
+*
+* @in table     Table of size mask + 1
+* @in mask      Table size minus one, the size is a power of two
+* @in slab      A slab address
+*
+* @ret          The slot of the slab, a free slot if it is not in the
+*               table, -1 if the table is full
+*/
+static long sg_slab_find(const sg_slab_count_t* table, size_t mask, size_t slab)
+{
+  size_t i = ((slab / SG_POOL_SLAB_BYTES) * 2654435761u) & mask;
+  size_t probes;
+
+  for (probes = 0; probes <= mask; probes++)
+  {
+    if (table[i].slab == slab || table[i].slab == 0) return (long)i;
+    i = (i + 1) & mask;
+  }
+
+  return -1;
+}
+
+/*
+* sg_pool_trim  Give the slabs found whole in the calling thread's pool back
+*
+* @in keep      Number of free entries the pool keeps
+*
+* @note         Free entries are counted per slab, a slab all of whose
+*               entries are in the pool is neither in use nor held
+*               anywhere else. Linear in the size of the pool, the next
+*               trim waits for the pool to double so the cost is
+*               amortized over the releases.
+*/
+static void sg_pool_trim(int keep)
+{
+  sg_slab_count_t* table = NULL;
+  sg_entry_t** link;
+  sg_entry_t* entry;
+  size_t size = 16;
+  size_t i;
+  long slot;
+  int to_free = 0;
+  int freed = 0;
+
+  if (sg_pool.free_count - keep >= SG_SLAB_ENTRIES)
+  {
+    // the pool holds entries of at most every live slab
+    while (size < 2 * (size_t)SG_ATOMIC_LOAD(&sg_slabs_live)) size *= 2;
+    table = (sg_slab_count_t*)calloc(size, sizeof(sg_slab_count_t));
+  }
+
+  if (table != NULL)
+  {
+    for (entry = sg_pool.free_list; entry != NULL; entry = entry->next)
+    {
+      slot = sg_slab_find(table, size - 1, SG_SLAB_OF(entry));
+      if (slot < 0) break;
+      table[slot].slab = SG_SLAB_OF(entry);
+      table[slot].count++;
+    }
+
+    // pick as many whole slabs as the pool can spare
+    if (entry == NULL) to_free = (sg_pool.free_count - keep) / SG_SLAB_ENTRIES;
+    for (i = 0; i < size && freed < to_free; i++)
+    {
+      if (table[i].count != SG_SLAB_ENTRIES) continue;
+      table[i].count = -1;
+      freed++;
+    }
+    sg_pool.free_count -= freed * SG_SLAB_ENTRIES;
+
+    // unlink their entries before any of them is freed
+    link = &sg_pool.free_list;
+    while (freed > 0 && *link != NULL)
+    {
+      entry = *link;
+      if (table[sg_slab_find(table, size - 1, SG_SLAB_OF(entry))].count < 0)
+        *link = entry->next;
+      else
+        link = &entry->next;
+    }
+
+    for (i = 0; i < size && freed > 0; i++)
+    {
+      if (table[i].count >= 0) continue;
+      sg_slab_free((void*)table[i].slab);
+      freed--;
+    }
+    free(table);
+  }
+
+  sg_pool.trim_at = 2 * sg_pool.free_count;
+  if (sg_pool.trim_at < SG_POOL_TRIM_ENTRIES) sg_pool.trim_at = SG_POOL_TRIM_ENTRIES;
+}
+
+/*
+* sg_pool_alloc Take a chain of entries from the calling thread's pool
+*
+* @in n         Number of entries
+*
+* @ret          A chain of n linked entries, NULL on failure
+*/
+sg_entry_t* sg_pool_alloc(int n)
+{
+  sg_entry_t* head;
+  sg_entry_t* tail;
+  int i;
+
+  if (n <= 0) return NULL;
+  if (!sg_pool.registered) sg_pool_register();
+
+  // entries freed by other threads are reused before new slabs are made
+  while (sg_pool.free_count < n && sg_depot_get() == 0)
+  {
+  }
+  if (sg_pool.free_count < n) sg_orphans_get();
+  if (sg_pool.free_count < n)
+  {
+    if (sg_pool_refill(n - sg_pool.free_count) != 0) return NULL;
+  }
+
+  // cut the first n entries off the free list
+  head = sg_pool.free_list;
+  tail = head;
+  for (i = 1; i < n; i++)
+  {
+    tail = tail->next;
+  }
+  sg_pool.free_list = tail->next;
+  sg_pool.free_count -= n;
+  tail->next = NULL;
+
+  return head;
+}
+
+/*
+* sg_pool_release Give a chain of entries back to the calling thread's pool
+*
+* @in head      First entry of the chain
+* @in tail      Last entry of the chain
+* @in n         Number of entries in the chain
+*
+* @note         The entries must come from sg_pool_alloc, on any thread.
+*/
+void sg_pool_release(sg_entry_t* head, sg_entry_t* tail, int n)
+{
+  if (head == NULL || tail == NULL || n <= 0) return;
+  if (!sg_pool.registered) sg_pool_register();
+
+  tail->next = sg_pool.free_list;
+  sg_pool.free_list = head;
+  sg_pool.free_count += n;
+
+  if (sg_pool.free_count <= SG_POOL_MAGAZINE_ENTRIES) return;
+
+  // whole slabs go back to the system, entries of lists built on other
+  // threads flow back through the depot
+  if (sg_pool.free_count > sg_pool.trim_at) sg_pool_trim(SG_POOL_MAGAZINE_ENTRIES);
+  while (sg_pool.free_count > SG_POOL_MAGAZINE_ENTRIES && sg_depot_put() == 0)
+  {
+  }
+
+  // a pool that shrank without trimming trims earlier next time
+  if (sg_pool.trim_at > 2 * sg_pool.free_count && sg_pool.trim_at > SG_POOL_TRIM_ENTRIES)
+  {
+    sg_pool.trim_at = 2 * sg_pool.free_count;
+    if (sg_pool.trim_at < SG_POOL_TRIM_ENTRIES) sg_pool.trim_at = SG_POOL_TRIM_ENTRIES;
+  }
+}
+
+/*
+* sg_pool_flush Empty the calling thread's pool
+*
+* @note         Whole slabs are given back to the system, full batches go
+*               to the depot as far as it has room and the remaining
+*               entries are left to the other threads. Done automatically
+*               when a thread exits.
+*/
+void sg_pool_flush(void)
+{
+  sg_entry_t* tail;
+
+  sg_pool_trim(0);
+  while (sg_depot_put() == 0)
+  {
+  }
+
+  if (sg_pool.free_list != NULL)
+  {
+    for (tail = sg_pool.free_list; tail->next != NULL; tail = tail->next)
+    {
+    }
+    sg_orphans_put(sg_pool.free_list, tail);
+    sg_pool.free_list = NULL;
+    sg_pool.free_count = 0;
+  }
+}
+
+static sg_entry_t* sg_pool_alloc_cb(void* ctx, int n)
+{
+  (void)ctx;
+  return sg_pool_alloc(n);
+}
+
+static void sg_pool_release_cb(void* ctx, sg_entry_t* head, sg_entry_t* tail, int n)
+{
+  (void)ctx;
+  sg_pool_release(head, tail, n);
+}
+
+const sg_allocator_t sg_default_allocator = {
+  sg_pool_alloc_cb,
+  sg_pool_release_cb,
+  NULL
+};
+
+static sg_entry_t* sg_arena_alloc_cb(void* ctx, int n)
+{
+  sg_arena_t* arena = (sg_arena_t*)ctx;
+  sg_entry_t* head;
+  int i;
+
+  if (n <= 0) return NULL;
+  if (arena->capacity - arena->used < n) return NULL;
+
+  head = &arena->entries[arena->used];
+  for (i = 0; i < n - 1; i++)
+  {
+    head[i].next = &head[i + 1];
+  }
+  head[n - 1].next = NULL;
+  arena->used += n;
+
+  return head;
+}
+
+static void sg_arena_release_cb(void* ctx, sg_entry_t* head, sg_entry_t* tail, int n)
+{
+  // entries are given back all at once by sg_arena_reset
+  (void)ctx;
+  (void)head;
+  (void)tail;
+  (void)n;
+}
+
+/*
+* sg_arena_init Initialize an entry arena
+*
+* @in arena     Arena to initialize
+* @in capacity  Number of entries the arena can hand out
+*
+* @ret          0 on success, -1 on failure
+*/
+int sg_arena_init(sg_arena_t* arena, int capacity)
+{
+  if (arena == NULL) return -1;
+  if (capacity <= 0) return -1;
+
+  arena->entries = (sg_entry_t*)malloc(capacity * sizeof(sg_entry_t));
+  if (arena->entries == NULL) return -1;
+
+  arena->capacity = capacity;
+  arena->used = 0;
+  arena->allocator.alloc = sg_arena_alloc_cb;
+  arena->allocator.release = sg_arena_release_cb;
+  arena->allocator.ctx = arena;
+
+  return 0;
+}
+
+/*
+* sg_arena_reset Give every entry of an arena back in O(1)
+*
+* @in arena     An initialized arena
+*
+* @note         All lists built from the arena become invalid.
+*/
+void sg_arena_reset(sg_arena_t* arena)
+{
+  if (arena == NULL) return;
+
+  arena->used = 0;
+}
+
+/*
+* sg_arena_free Free the storage of an arena
+*
+* @in arena     An initialized arena
+*/
+void sg_arena_free(sg_arena_t* arena)
+{
+  if (arena == NULL) return;
+
+  free(arena->entries);
+  arena->entries = NULL;
+  arena->capacity = 0;
+  arena->used = 0;
+}
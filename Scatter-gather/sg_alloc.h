@@ -0,0 +1,193 @@
+#ifndef SG_ALLOC_H
+#define SG_ALLOC_H
+
+#include "sg_copy.h"
+
+#define SG_POOL_SLAB_BYTES 16384	/* size and alignment of a slab of entries */
+#define SG_POOL_BATCH_ENTRIES 256	/* entries moved to or from the depot at once */
+#define SG_POOL_MAGAZINE_ENTRIES 1024	/* free entries a thread keeps for itself */
+#define SG_POOL_DEPOT_SLOTS 64		/* batches the shared depot can hold */
+
+/*
+ * Scatter-gather entry allocator
+ *
+ * Note: alloc returns a chain of n entries linked through "next",
+ * the "next" of the last entry is NULL. It returns NULL on failure.
+ * release takes back a chain of n entries from head to tail, it must
+ * not walk the chain so lists can be returned in O(1). Callers that know
+ * the tail, sg_list_destroy and sg_arena_reset, are O(1). sg_destroy and
+ * sg_destroy_with are not: a bare list has to be walked to find its tail
+ * and to mark each entry as freed
+ */
+typedef struct sg_allocator_s sg_allocator_t;
+struct sg_allocator_s {
+	sg_entry_t *(*alloc)(void *ctx, int n);
+	void (*release)(void *ctx, sg_entry_t *head, sg_entry_t *tail, int n);
+	void *ctx;                      /* passed to alloc and release */
+};
+
+/*
+ * Entry arena
+ *
+ * Note: a fixed block of entries handed out by bumping "used".
+ * Releasing entries is a no-op, all of them are given back at once
+ * by sg_arena_reset
+ */
+typedef struct sg_arena_s sg_arena_t;
+struct sg_arena_s {
+	sg_entry_t *entries;            /* backing storage */
+	int capacity;                   /* number of entries in storage */
+	int used;                       /* number of entries handed out */
+	sg_allocator_t allocator;       /* allocator drawing from this arena */
+};
+
+/*
+ * sg_default_allocator  Allocator used by sg_map and sg_destroy
+ *
+ * @note         Draws entries from a per-thread slab pool. Slabs of
+ *               SG_POOL_SLAB_BYTES are allocated as needed. A pool keeps
+ *               about SG_POOL_MAGAZINE_ENTRIES free entries, it gives
+ *               back the slabs all of whose entries it holds beyond that.
+ *               Lists may be destroyed on another thread than the one
+ *               that built them: free entries that cannot be given back
+ *               go, SG_POOL_BATCH_ENTRIES at a time, to a lock-free depot
+ *               of at most SG_POOL_DEPOT_SLOTS batches the other threads
+ *               refill from. The pool of a thread is flushed when the
+ *               thread exits.
+ */
+extern const sg_allocator_t sg_default_allocator;
+
+/*
+ * sg_pool_alloc Take a chain of entries from the calling thread's pool
+ *
+ * @in n         Number of entries
+ *
+ * @ret          A chain of n linked entries, NULL on failure
+ */
+extern sg_entry_t *sg_pool_alloc(int n);
+
+/*
+ * sg_pool_release Give a chain of entries back to the calling thread's pool
+ *
+ * @in head      First entry of the chain
+ * @in tail      Last entry of the chain
+ * @in n         Number of entries in the chain
+ *
+ * @note         The entries must come from sg_pool_alloc, on any thread.
+ */
+extern void sg_pool_release(sg_entry_t *head, sg_entry_t *tail, int n);
+
+/*
+ * sg_pool_flush Empty the calling thread's pool
+ *
+ * @note         Whole slabs are given back to the system, full batches go
+ *               to the depot as far as it has room and the remaining
+ *               entries are left to the other threads. Done automatically
+ *               when a thread exits.
+ */
+extern void sg_pool_flush(void);
+
+/*
+ * sg_arena_init Initialize an entry arena
+ *
+ * @in arena     Arena to initialize
+ * @in capacity  Number of entries the arena can hand out
+ *
+ * @ret          0 on success, -1 on failure
+ */
+extern int sg_arena_init(sg_arena_t *arena, int capacity);
+
+/*
+ * sg_arena_reset Give every entry of an arena back in O(1)
+ *
+ * @in arena     An initialized arena
+ *
+ * @note         All lists built from the arena become invalid.
+ */
+extern void sg_arena_reset(sg_arena_t *arena);
+
+/*
+ * sg_arena_free Free the storage of an arena
+ *
+ * @in arena     An initialized arena
+ */
+extern void sg_arena_free(sg_arena_t *arena);
+
+/*
+ * sg_map_with   Map a memory buffer using a given entry allocator
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ * @in allocator Entry allocator, NULL for sg_default_allocator
+ *
+ * @ret          A list of sg_entry elements mapping the input buffer
+ *
+ * @note         Same as sg_map, all the entries are reserved with a
+ *               single call to the allocator.
+ */
+extern sg_entry_t *sg_map_with(void *buf, int length,
+                               const sg_allocator_t *allocator);
+
+/*
+ * sg_map_geom   Map a memory buffer using a given geometry and allocator
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ * @in allocator Entry allocator, NULL for sg_default_allocator
+ *
+ * @ret          A list of sg_entry elements mapping the input buffer
+ *
+ * @note         Same as sg_map_with, with entries mapping up to
+ *               geom->page_size bytes each.
+ */
+extern sg_entry_t *sg_map_geom(void *buf, int length, const sg_geom_t *geom,
+                               const sg_allocator_t *allocator);
+
+/*
+ * sg_map_geom64 Map a memory buffer of any size using a geometry and allocator
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ * @in allocator Entry allocator, NULL for sg_default_allocator
+ *
+ * @ret          A list of sg_entry elements mapping the input buffer
+ *
+ * @note         Same as sg_map_geom, for buffers of 2 GiB and more.
+ */
+extern sg_entry_t *sg_map_geom64(void *buf, size_t length, const sg_geom_t *geom,
+                                 const sg_allocator_t *allocator);
+
+/*
+ * sg_map_chain  Fill a chain of entries with the mapping of a buffer
+ *
+ * @in chain     Linked entries, at least as many as the mapping needs
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes, positive
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ *
+ * @ret          The last entry filled, its next entry is left untouched
+ *
+ * @note         Only paddr and count are set, so a chain reserved in one
+ *               allocation can be filled by several buffers in turn.
+ */
+extern sg_entry_t *sg_map_chain(sg_entry_t *chain, void *buf, size_t length,
+                                const sg_geom_t *geom);
+
+/*
+ * sg_destroy_with Destroy a scatter-gather list using a given allocator
+ *
+ * @in sg_list   A scatter-gather list
+ * @in allocator The allocator the list was built with, NULL for
+ *               sg_default_allocator
+ *
+ * @note         The whole list is returned with a single call to the
+ *               allocator, after one walk over its entries to find the
+ *               tail and mark them as freed, so the cost is O(n). Lists
+ *               kept in an sg_list_t are released in O(1) by
+ *               sg_list_destroy.
+ */
+extern void sg_destroy_with(sg_entry_t *sg_list, const sg_allocator_t *allocator);
+
+#endif /* SG_ALLOC_H */
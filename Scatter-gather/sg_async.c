@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include "sg_async.h"
+#include "sg_thread.h"
+
+/*
+* Asynchronous copy engine
+*
+* Note: completed copies are pushed on the completion queue by
+* sg_async_complete and reaped, in completion order, by the thread
+* polling the engine
+*/
+struct sg_async_s {
+  sg_async_backend_t backend;
+  sg_mutex_t lock;
+  sg_cond_t completed;
+  sg_async_op_t* done_head;
+  sg_async_op_t* done_tail;
+  int in_flight;                  // submitted and not reaped yet
+};
+
+/*
+* sg_async_cpu_run Run one copy on a worker thread
+*
+* @in task      The task embedded in an sg_async_op_t
+*/
+static void sg_async_cpu_run(sg_task_t* task)
+{
+  sg_async_op_t* op = (sg_async_op_t*)task;
+
+  sg_async_complete(op, sg_copy(op->desc.src, op->desc.dest,
+                                op->desc.src_offset, op->desc.count));
+}
+
+static int sg_async_cpu_submit(void* ctx, sg_async_op_t* op)
+{
+  op->task.run = sg_async_cpu_run;
+  sg_workers_submit((sg_workers_t*)ctx, &op->task);
+  return 0;
+}
+
+/*
+* sg_async_cpu_init Initialize a backend copying on a worker pool
+*
+* @in backend   Backend to initialize
+* @in workers   Worker pool running the copies, must outlive the engine
+*/
+void sg_async_cpu_init(sg_async_backend_t* backend, sg_workers_t* workers)
+{
+  backend->submit = sg_async_cpu_submit;
+  backend->shutdown = NULL;
+  backend->ctx = workers;
+}
+
+/*
+* sg_async_create Create an asynchronous copy engine
+*
+* @in backend   Backend running the copies, copied into the engine
+*
+* @ret          An engine, NULL on failure
+*/
+sg_async_t* sg_async_create(const sg_async_backend_t* backend)
+{
+  sg_async_t* engine;
+
+  if (backend == NULL || backend->submit == NULL) return NULL;
+
+  engine = (sg_async_t*)calloc(1, sizeof(sg_async_t));
+  if (engine == NULL) return NULL;
+
+  engine->backend = *backend;
+  if (sg_mutex_init(&engine->lock) != 0)
+  {
+    free(engine);
+    return NULL;
+  }
+  if (sg_cond_init(&engine->completed) != 0)
+  {
+    sg_mutex_destroy(&engine->lock);
+    free(engine);
+    return NULL;
+  }
+
+  return engine;
+}
+
+/*
+* sg_async_destroy Destroy an asynchronous copy engine
+*
+* @in engine    An engine
+*
+* @note         Waits for every submitted copy as by sg_async_wait,
+*               so pending callbacks still run.
+*/
+void sg_async_destroy(sg_async_t* engine)
+{
+  if (engine == NULL) return;
+
+  sg_async_wait(engine);
+  if (engine->backend.shutdown != NULL) engine->backend.shutdown(engine->backend.ctx);
+
+  sg_cond_destroy(&engine->completed);
+  sg_mutex_destroy(&engine->lock);
+  free(engine);
+}
+
+/*
+* sg_copy_async Start a copy using scatter-gather lists
+*
+* @in engine    An engine
+* @in desc      The copy, as for sg_copy_batch, copied by the engine
+* @in cb        Completion callback, may be NULL
+* @in ctx       Passed to cb
+*
+* @ret          0 if the copy was submitted, -1 on failure
+*
+* @note         Both lists and their buffers must stay valid until the
+*               copy has completed.
+*/
+int sg_copy_async(sg_async_t* engine, const sg_copy_desc_t* desc,
+                  sg_async_cb cb, void* ctx)
+{
+  sg_async_op_t* op;
+
+  if (engine == NULL || desc == NULL) return -1;
+
+  op = (sg_async_op_t*)calloc(1, sizeof(sg_async_op_t));
+  if (op == NULL) return -1;
+
+  op->desc = *desc;
+  op->cb = cb;
+  op->ctx = ctx;
+  op->engine = engine;
+
+  // counted before submitting, the backend may complete it right away
+  sg_mutex_lock(&engine->lock);
+  engine->in_flight++;
+  sg_mutex_unlock(&engine->lock);
+
+  if (engine->backend.submit(engine->backend.ctx, op) != 0)
+  {
+    sg_mutex_lock(&engine->lock);
+    engine->in_flight--;
+    sg_mutex_unlock(&engine->lock);
+    free(op);
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+* sg_async_complete Report a copy as done, called by backends
+*
+* @in op        The copy, as handed to the backend's submit
+* @in result    Number of bytes copied
+*
+* @note         May be called from any thread.
+*/
+void sg_async_complete(sg_async_op_t* op, int result)
+{
+  sg_async_t* engine = op->engine;
+
+  op->result = result;
+  op->next = NULL;
+
+  sg_mutex_lock(&engine->lock);
+  if (engine->done_tail == NULL)
+    engine->done_head = op;
+  else
+    engine->done_tail->next = op;
+  engine->done_tail = op;
+  sg_cond_broadcast(&engine->completed);
+  sg_mutex_unlock(&engine->lock);
+}
+
+/*
+* sg_async_reap Run the callbacks of every copy on the completion queue
+*
+* @in engine    An engine, locked by the caller
+*
+* @ret          Number of completed copies reaped
+*
+* @note         The lock is released while the callbacks run, so they may
+*               submit more copies.
+*/
+static int sg_async_reap(sg_async_t* engine)
+{
+  sg_async_op_t* op;
+  sg_async_op_t* next;
+  int num_reaped = 0;
+
+  op = engine->done_head;
+  engine->done_head = NULL;
+  engine->done_tail = NULL;
+  sg_mutex_unlock(&engine->lock);
+
+  for (; op != NULL; op = next)
+  {
+    next = op->next;
+    if (op->cb != NULL) op->cb(op->ctx, &op->desc, op->result);
+    free(op);
+    num_reaped++;
+  }
+
+  sg_mutex_lock(&engine->lock);
+  engine->in_flight -= num_reaped;
+  // another thread may be waiting on copies this one just reaped
+  if (num_reaped > 0) sg_cond_broadcast(&engine->completed);
+
+  return num_reaped;
+}
+
+/*
+* sg_async_poll Run the callbacks of completed copies without waiting
+*
+* @in engine    An engine
+*
+* @ret          Number of completed copies reaped
+*/
+int sg_async_poll(sg_async_t* engine)
+{
+  int num_reaped;
+
+  if (engine == NULL) return 0;
+
+  sg_mutex_lock(&engine->lock);
+  num_reaped = sg_async_reap(engine);
+  sg_mutex_unlock(&engine->lock);
+
+  return num_reaped;
+}
+
+/*
+* sg_async_wait Wait for every submitted copy and run its callback
+*
+* @in engine    An engine
+*
+* @ret          Number of completed copies reaped
+*/
+int sg_async_wait(sg_async_t* engine)
+{
+  int num_reaped = 0;
+
+  if (engine == NULL) return 0;
+
+  sg_mutex_lock(&engine->lock);
+  while (engine->in_flight > 0)
+  {
+    if (engine->done_head == NULL)
+      sg_cond_wait(&engine->completed, &engine->lock);
+    else
+      num_reaped += sg_async_reap(engine);
+  }
+  sg_mutex_unlock(&engine->lock);
+
+  return num_reaped;
+}
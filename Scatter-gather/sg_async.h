@@ -0,0 +1,127 @@
+#ifndef SG_ASYNC_H
+#define SG_ASYNC_H
+
+#include "sg_copy.h"
+#include "sg_batch.h"
+#include "sg_workers.h"
+
+typedef struct sg_async_s sg_async_t;
+typedef struct sg_async_op_s sg_async_op_t;
+
+/*
+ * Completion callback
+ *
+ * Note: called by sg_async_poll or sg_async_wait on the thread polling
+ * the engine, never on a backend thread. "result" is the number of
+ * bytes copied, as returned by sg_copy
+ */
+typedef void (*sg_async_cb)(void *ctx, const sg_copy_desc_t *desc, int result);
+
+/*
+ * In-flight asynchronous copy
+ *
+ * Note: allocated by sg_copy_async and handed to the backend, which
+ * must call sg_async_complete exactly once when the copy is done.
+ * "task" and "backend_data" belong to the backend
+ */
+struct sg_async_op_s {
+	sg_task_t task;                 /* for backends running on sg_workers */
+	void *backend_data;             /* for any other backend */
+	sg_copy_desc_t desc;            /* the copy to run */
+	sg_async_cb cb;                 /* completion callback, may be NULL */
+	void *ctx;                      /* passed to cb */
+	int result;                     /* set by sg_async_complete */
+	sg_async_t *engine;             /* engine the copy was submitted to */
+	struct sg_async_op_s *next;     /* used by the completion queue */
+};
+
+/*
+ * Asynchronous copy backend
+ *
+ * Note: submit starts the copy described by op->desc and returns 0, or
+ * returns -1 if it cannot take the copy. It must not wait for the copy.
+ * A copy offload engine (e.g. Intel DSA or I/OAT) is plugged in here:
+ * submit translates the source and destination lists into hardware
+ * descriptors and the engine's completion handler calls
+ * sg_async_complete. shutdown, if not NULL, is called by
+ * sg_async_destroy once every copy has completed
+ */
+typedef struct sg_async_backend_s sg_async_backend_t;
+struct sg_async_backend_s {
+	int (*submit)(void *ctx, sg_async_op_t *op);
+	void (*shutdown)(void *ctx);
+	void *ctx;                      /* passed to submit and shutdown */
+};
+
+/*
+ * sg_async_cpu_init Initialize a backend copying on a worker pool
+ *
+ * @in backend   Backend to initialize
+ * @in workers   Worker pool running the copies, must outlive the engine
+ */
+extern void sg_async_cpu_init(sg_async_backend_t *backend, sg_workers_t *workers);
+
+/*
+ * sg_async_create Create an asynchronous copy engine
+ *
+ * @in backend   Backend running the copies, copied into the engine
+ *
+ * @ret          An engine, NULL on failure
+ */
+extern sg_async_t *sg_async_create(const sg_async_backend_t *backend);
+
+/*
+ * sg_async_destroy Destroy an asynchronous copy engine
+ *
+ * @in engine    An engine
+ *
+ * @note         Waits for every submitted copy as by sg_async_wait,
+ *               so pending callbacks still run.
+ */
+extern void sg_async_destroy(sg_async_t *engine);
+
+/*
+ * sg_copy_async Start a copy using scatter-gather lists
+ *
+ * @in engine    An engine
+ * @in desc      The copy, as for sg_copy_batch, copied by the engine
+ * @in cb        Completion callback, may be NULL
+ * @in ctx       Passed to cb
+ *
+ * @ret          0 if the copy was submitted, -1 on failure
+ *
+ * @note         Both lists and their buffers must stay valid until the
+ *               copy has completed.
+ */
+extern int sg_copy_async(sg_async_t *engine, const sg_copy_desc_t *desc,
+                         sg_async_cb cb, void *ctx);
+
+/*
+ * sg_async_poll Run the callbacks of completed copies without waiting
+ *
+ * @in engine    An engine
+ *
+ * @ret          Number of completed copies reaped
+ */
+extern int sg_async_poll(sg_async_t *engine);
+
+/*
+ * sg_async_wait Wait for every submitted copy and run its callback
+ *
+ * @in engine    An engine
+ *
+ * @ret          Number of completed copies reaped
+ */
+extern int sg_async_wait(sg_async_t *engine);
+
+/*
+ * sg_async_complete Report a copy as done, called by backends
+ *
+ * @in op        The copy, as handed to the backend's submit
+ * @in result    Number of bytes copied
+ *
+ * @note         May be called from any thread.
+ */
+extern void sg_async_complete(sg_async_op_t *op, int result);
+
+#endif /* SG_ASYNC_H */
@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include "sg_batch.h"
+#include "sg_stats.h"
+
+/*
+* Position of a descriptor in the batch, sorted by source list and offset
+*/
+typedef struct sg_batch_slot_s {
+  const sg_copy_desc_t* desc;
+  int index;
+} sg_batch_slot_t;
+
+static int sg_batch_slot_compare(const void* a, const void* b)
+{
+  const sg_batch_slot_t* slot_a = (const sg_batch_slot_t*)a;
+  const sg_batch_slot_t* slot_b = (const sg_batch_slot_t*)b;
+
+  if (slot_a->desc->src != slot_b->desc->src)
+    return (size_t)slot_a->desc->src < (size_t)slot_b->desc->src ? -1 : 1;
+  if (slot_a->desc->src_offset != slot_b->desc->src_offset)
+    return slot_a->desc->src_offset < slot_b->desc->src_offset ? -1 : 1;
+  // keep the submission order of equal descriptors
+  return slot_a->index - slot_b->index;
+}
+
+/*
+* sg_copy_batch Run many copies using scatter-gather lists
+*
+* @in descs     Array of copy descriptors
+* @in n         Number of descriptors
+* @out results  Actual number of bytes copied by each descriptor,
+*               may be NULL
+*
+* @ret          Total number of bytes copied
+*
+* @note         Each descriptor is copied as by sg_copy. Descriptors are
+*               grouped by source list and run in increasing source offset,
+*               so the source is walked once per group instead of once per
+*               descriptor. The copies must therefore not depend on each
+*               other, e.g. one copy must not write what another one reads.
+*/
+int sg_copy_batch(const sg_copy_desc_t* descs, int n, int* results)
+{
+  sg_batch_slot_t* slots;
+  sg_entry_t* cursor_src = NULL;
+  sg_entry_t* cursor_entry = NULL;
+  int cursor_base = 0;
+  int total_copied = 0;
+  int i;
+
+  if (descs == NULL || n <= 0) return 0;
+
+  slots = (sg_batch_slot_t*)malloc(n * sizeof(sg_batch_slot_t));
+  for (i = 0; slots != NULL && i < n; i++)
+  {
+    slots[i].desc = &descs[i];
+    slots[i].index = i;
+  }
+  // without the sorted order the copies run as submitted, each walking
+  // its source from the head
+  if (slots != NULL) qsort(slots, n, sizeof(sg_batch_slot_t), sg_batch_slot_compare);
+
+  for (i = 0; i < n; i++)
+  {
+    const sg_copy_desc_t* desc = slots != NULL ? slots[i].desc : &descs[i];
+    int index = slots != NULL ? slots[i].index : i;
+    sg_entry_t* src_curr;
+    int offset_in_src_entry;
+    int bytes_copied = 0;
+
+    // no bytes are copied if one of the parameters is illogical
+    if (desc->dest != NULL && desc->src_offset >= 0 && desc->count > 0)
+    {
+      // restart from the head of the source when the cursor cannot be used
+      if (desc->src != cursor_src || desc->src_offset < cursor_base || cursor_entry == NULL)
+      {
+        cursor_src = desc->src;
+        cursor_entry = desc->src;
+        cursor_base = 0;
+      }
+
+      if (sg_seek(cursor_entry, desc->src_offset - cursor_base,
+                  &src_curr, &offset_in_src_entry) == 0)
+      {
+        // the entry found is where the next descriptor starts looking
+        cursor_entry = src_curr;
+        cursor_base = desc->src_offset - offset_in_src_entry;
+        bytes_copied = sg_copy_at(src_curr, offset_in_src_entry,
+                                  desc->dest, 0, desc->count);
+      }
+      else
+      {
+        // sg_copy_at counts the copies that run short
+        SG_STAT_ADD(short_copies, 1);
+      }
+    }
+
+    if (results != NULL) results[index] = bytes_copied;
+    total_copied += bytes_copied;
+  }
+
+  free(slots);
+
+  return total_copied;
+}
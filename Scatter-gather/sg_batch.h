@@ -0,0 +1,37 @@
+#ifndef SG_BATCH_H
+#define SG_BATCH_H
+
+#include "sg_copy.h"
+
+/*
+ * Copy descriptor
+ *
+ * Note: the arguments of one sg_copy call
+ */
+typedef struct sg_copy_desc_s sg_copy_desc_t;
+struct sg_copy_desc_s {
+	sg_entry_t *src;                /* source sg list */
+	sg_entry_t *dest;               /* destination sg list */
+	int src_offset;                 /* offset into source */
+	int count;                      /* number of bytes to copy */
+};
+
+/*
+ * sg_copy_batch Run many copies using scatter-gather lists
+ *
+ * @in descs     Array of copy descriptors
+ * @in n         Number of descriptors
+ * @out results  Actual number of bytes copied by each descriptor,
+ *               may be NULL
+ *
+ * @ret          Total number of bytes copied
+ *
+ * @note         Each descriptor is copied as by sg_copy. Descriptors are
+ *               grouped by source list and run in increasing source offset,
+ *               so the source is walked once per group instead of once per
+ *               descriptor. The copies must therefore not depend on each
+ *               other, e.g. one copy must not write what another one reads.
+ */
+extern int sg_copy_batch(const sg_copy_desc_t *descs, int n, int *results);
+
+#endif /* SG_BATCH_H */
@@ -1,6 +1,12 @@
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include "sg_copy.h"
+#include "sg_alloc.h"
+#include "sg_run.h"
+#include "sg_stats.h"
+#include "sg_csum.h"
+#include "sg_prefetch.h"
 
 /*
 * init_entry    Initialize an entry in a scatter-gather list
@@ -34,63 +40,336 @@ void init_entry(sg_entry_t* entry, physaddr_t paddr, int count, sg_entry_t* next
 */
 sg_entry_t* sg_map(void* buf, int length)
 {
-  physaddr_t paddr = ptr_to_phys(buf);
-  sg_entry_t* list_head;
-  sg_entry_t* list_curr;
-  sg_entry_t* list_prev;
-  int remaining_length;
-  int count = 0;
+  return sg_map_with(buf, length, &sg_default_allocator);
+}
+
+/*
+* sg_map_into   Map a memory buffer into caller-provided entries
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+* @in entries   Array of entries to fill, e.g. on the stack
+* @in capacity  Number of entries in the array
+*
+* @ret          The number of entries the mapping needs, 0 on illegal
+*               parameters
+*
+* @note         Same entries as sg_map, linked in array order starting
+*               from entries[0]. Nothing is written when the array holds
+*               fewer entries than the returned number. The list must
+*               not be passed to sg_destroy, see sg_destroy_into.
+*/
+int sg_map_into(void* buf, int length, sg_entry_t* entries, int capacity)
+{
+  int head_count;
+  int num_full_pages;
+  int tail_count;
+  int num_entries;
   int total_count;
+  int i;
+
+  // check for illegal input parameters
+  if (buf == NULL) return 0;
+  if (length <= 0) return 0;
+
+  num_entries = sg_map_layout(buf, length, &head_count, &num_full_pages, &tail_count);
+  if (entries == NULL || capacity < num_entries) return num_entries;
+
+  // note: cast to char in order to do pointer arithmetic in bytes
+  total_count = 0;
+  for (i = 0; i < num_entries; i++)
+  {
+    int count = i == 0 ? head_count : PAGE_SIZE;
+
+    if (i == num_entries - 1 && tail_count > 0) count = tail_count;
+
+    init_entry(&entries[i], ptr_to_phys((char*)buf + total_count), count,
+               i < num_entries - 1 ? &entries[i + 1] : NULL);
+    total_count += count;
+  }
+
+  return num_entries;
+}
+
+/*
+* sg_map_with   Map a memory buffer using a given entry allocator
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+* @in allocator Entry allocator, NULL for sg_default_allocator
+*
+* @ret          A list of sg_entry elements mapping the input buffer
+*
+* @note         Same as sg_map, all the entries are reserved with a
+*               single call to the allocator.
+*/
+sg_entry_t* sg_map_with(void* buf, int length, const sg_allocator_t* allocator)
+{
+  return sg_map_geom(buf, length, &sg_default_geom, allocator);
+}
+
+/*
+* sg_map_geom   Map a memory buffer using a given geometry and allocator
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+* @in geom      Mapping geometry, NULL for sg_default_geom
+* @in allocator Entry allocator, NULL for sg_default_allocator
+*
+* @ret          A list of sg_entry elements mapping the input buffer
+*
+* @note         Same as sg_map_with, with entries mapping up to
+*               geom->page_size bytes each.
+*/
+sg_entry_t* sg_map_geom(void* buf, int length, const sg_geom_t* geom,
+                        const sg_allocator_t* allocator)
+{
+  // check for illegal input parameters
+  if (length <= 0) return NULL;
+
+  return sg_map_geom64(buf, (size_t)length, geom, allocator);
+}
+
+/*
+* sg_map64      Map a memory buffer of any size using a scatter-gather list
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+*
+* @ret          A list of sg_entry elements mapping the input buffer
+*
+* @note         Same as sg_map, for buffers of 2 GiB and more.
+*/
+sg_entry_t* sg_map64(void* buf, size_t length)
+{
+  return sg_map_geom64(buf, length, &sg_default_geom, &sg_default_allocator);
+}
+
+/*
+* sg_map_geom64 Map a memory buffer of any size using a geometry and allocator
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+* @in geom      Mapping geometry, NULL for sg_default_geom
+* @in allocator Entry allocator, NULL for sg_default_allocator
+*
+* @ret          A list of sg_entry elements mapping the input buffer
+*
+* @note         Same as sg_map_geom, for buffers of 2 GiB and more.
+*/
+sg_entry_t* sg_map_geom64(void* buf, size_t length, const sg_geom_t* geom,
+                          const sg_allocator_t* allocator)
+{
+  sg_entry_t* list_head;
+  int head_count;
+  size_t num_full_pages;
+  int tail_count;
+  size_t num_entries;
   
   // check for illegal input parameters
   if (buf == NULL) return NULL;
-  if (length <= 0) return NULL;
+  if (length == 0) return NULL;
+  if (geom == NULL) geom = &sg_default_geom;
+  if (allocator == NULL) allocator = &sg_default_allocator;
+
+  num_entries = sg_map_layout64(buf, length, geom,
+                                &head_count, &num_full_pages, &tail_count);
+  // allocators count entries with an int
+  if (num_entries > INT_MAX) return NULL;
+
+  // reserve all the entries at once
+  list_head = allocator->alloc(allocator->ctx, (int)num_entries);
+  if (list_head == NULL) return NULL;
+  SG_STAT_ADD(entries_allocated, num_entries);
+
+  // the allocated chain is already linked, only the values are set
+  sg_map_chain(list_head, buf, length, geom);
+
+  return list_head;
+}
+
+/*
+* sg_map_chain  Fill a chain of entries with the mapping of a buffer
+*
+* @in chain     Linked entries, at least as many as the mapping needs
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes, positive
+* @in geom      Mapping geometry, NULL for sg_default_geom
+*
+* @ret          The last entry filled, its next entry is left untouched
+*
+* @note         Only paddr and count are set, so a chain reserved in one
+*               allocation can be filled by several buffers in turn.
+*/
+sg_entry_t* sg_map_chain(sg_entry_t* chain, void* buf, size_t length,
+                         const sg_geom_t* geom)
+{
+  sg_entry_t* list_curr = chain;
+  int head_count;
+  size_t num_full_pages;
+  int tail_count;
+  size_t total_count;
+  size_t i;
+
+  if (geom == NULL) geom = &sg_default_geom;
+
+  sg_map_layout64(buf, length, geom, &head_count, &num_full_pages, &tail_count);
+
+  init_entry(list_curr, ptr_to_phys(buf), head_count, list_curr->next);
+  total_count = head_count;
 
-  // align the entries on a PAGE_SIZE address, starting from the second entry.
-  // hence, count how many bytes to include in the first entry in order
-  // to align the rest of the entries
   // note: cast to char in order to do pointer arithmetic in bytes
-  while ((ptr_to_phys((char*)buf + count) % PAGE_SIZE) && (count < length))
+  for (i = 0; i < num_full_pages; i++)
   {
-    count++;
+    list_curr = list_curr->next;
+    init_entry(list_curr, ptr_to_phys((char*)buf + total_count), geom->page_size,
+               list_curr->next);
+    total_count += geom->page_size;
   }
 
-  // check if the initial physical address is aligned on a PAGE_SIZE address 
-  if (count == 0)
+  if (tail_count > 0)
   {
-    count = length <= PAGE_SIZE ? length : PAGE_SIZE;
+    list_curr = list_curr->next;
+    init_entry(list_curr, ptr_to_phys((char*)buf + total_count), tail_count,
+               list_curr->next);
   }
 
-  // create new scatter-gather list
-  list_head = (sg_entry_t*)malloc(sizeof(sg_entry_t));
-  init_entry(list_head, paddr, count, NULL);
-  list_prev = list_head;
+  return list_curr;
+}
 
-  // update status
-  remaining_length = length - count;
-  total_count = count;
+/*
+* sg_map_layout Compute how a buffer is split into scatter-gather entries
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes, positive
+* @out head_count Number of bytes in the first entry
+* @out num_full_pages Number of full PAGE_SIZE entries after the first one
+* @out tail_count Number of bytes in the last, partial entry, 0 if none
+*
+* @ret          The total number of entries
+*
+* @note         The first entry runs up to the first PAGE_SIZE boundary,
+*               or is a full page if the buffer is already aligned.
+*/
+int sg_map_layout(void* buf, int length, int* head_count,
+                  int* num_full_pages, int* tail_count)
+{
+  return sg_map_layout_geom(buf, length, &sg_default_geom,
+                            head_count, num_full_pages, tail_count);
+}
+
+/*
+* sg_geom_init  Initialize a mapping geometry
+*
+* @out geom     Geometry to initialize
+* @in page_size Largest number of bytes per entry, positive
+*
+* @ret          0 on success, -1 on illegal parameters
+*/
+int sg_geom_init(sg_geom_t* geom, int page_size)
+{
+  int shift = 0;
 
-  while (remaining_length > 0)
+  if (geom == NULL) return -1;
+  if (page_size <= 0) return -1;
+
+  geom->page_size = page_size;
+  geom->page_shift = -1;
+
+  // powers of two have a single bit set
+  if ((page_size & (page_size - 1)) == 0)
   {
-    // calculate count and address
-    paddr = ptr_to_phys((char*)buf + total_count);
-    count = remaining_length <= PAGE_SIZE ?
-            remaining_length : PAGE_SIZE;
-    total_count += count;
+    while ((1 << shift) < page_size) shift++;
+    geom->page_shift = shift;
+  }
 
-    // create new entry
-    list_curr = (sg_entry_t*)malloc(sizeof(sg_entry_t));
-    // insert values to the current entry
-    init_entry(list_curr, paddr, count, NULL);
-    // connect previous entry with the current entry
-    list_prev->next = list_curr;
-    // prepare for the next iteration
-    list_prev = list_curr;
-    // update status
-    remaining_length -= count;
+  return 0;
+}
+
+// PAGE_SHIFT must match PAGE_SIZE
+typedef char sg_page_shift_check[(1 << PAGE_SHIFT) == PAGE_SIZE ? 1 : -1];
+
+const sg_geom_t sg_default_geom = { PAGE_SIZE, PAGE_SHIFT };
+
+/*
+* sg_map_layout_geom Compute how a buffer is split into entries of a geometry
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes, positive
+* @in geom      Mapping geometry, NULL for sg_default_geom
+* @out head_count Number of bytes in the first entry
+* @out num_full_pages Number of full page entries after the first one
+* @out tail_count Number of bytes in the last, partial entry, 0 if none
+*
+* @ret          The total number of entries
+*
+* @note         Same as sg_map_layout with geom->page_size pages.
+*/
+int sg_map_layout_geom(void* buf, int length, const sg_geom_t* geom,
+                       int* head_count, int* num_full_pages, int* tail_count)
+{
+  size_t num_full_pages64;
+  size_t num_entries;
+
+  num_entries = sg_map_layout64(buf, (size_t)length, geom,
+                                head_count, &num_full_pages64, tail_count);
+  *num_full_pages = (int)num_full_pages64;
+
+  return (int)num_entries;
+}
+
+/*
+* sg_map_layout64 Compute how a buffer of any size is split into entries
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes, positive
+* @in geom      Mapping geometry, NULL for sg_default_geom
+* @out head_count Number of bytes in the first entry
+* @out num_full_pages Number of full page entries after the first one
+* @out tail_count Number of bytes in the last, partial entry, 0 if none
+*
+* @ret          The total number of entries
+*
+* @note         Same as sg_map_layout_geom, for buffers of 2 GiB and more.
+*/
+size_t sg_map_layout64(void* buf, size_t length, const sg_geom_t* geom,
+                       int* head_count, size_t* num_full_pages, int* tail_count)
+{
+  size_t addr = (size_t)buf;
+  size_t head_length;
+  size_t remaining_length;
+
+  if (geom == NULL || geom->page_size == PAGE_SIZE)
+  {
+    // align the entries on a PAGE_SIZE address, starting from the second
+    // entry. the divisions by a constant page size compile to shifts
+    head_length = PAGE_SIZE - (size_t)(ptr_to_phys(buf) % PAGE_SIZE);
+    if (head_length > length) head_length = length;
+    remaining_length = length - head_length;
+    *num_full_pages = remaining_length / PAGE_SIZE;
+    *tail_count = (int)(remaining_length % PAGE_SIZE);
   }
+  else if (geom->page_shift >= 0)
+  {
+    size_t page_mask = (size_t)geom->page_size - 1;
 
-  return list_head;
+    head_length = (size_t)geom->page_size - (addr & page_mask);
+    if (head_length > length) head_length = length;
+    remaining_length = length - head_length;
+    *num_full_pages = remaining_length >> geom->page_shift;
+    *tail_count = (int)(remaining_length & page_mask);
+  }
+  else
+  {
+    head_length = (size_t)geom->page_size - addr % geom->page_size;
+    if (head_length > length) head_length = length;
+    remaining_length = length - head_length;
+    *num_full_pages = remaining_length / geom->page_size;
+    *tail_count = (int)(remaining_length % geom->page_size);
+  }
+  *head_count = (int)head_length;
+
+  return 1 + *num_full_pages + (*tail_count > 0 ? 1 : 0);
 }
 
 /*
@@ -100,22 +379,116 @@ sg_entry_t* sg_map(void* buf, int length)
 */
 void sg_destroy(sg_entry_t* sg_list)
 {
-  sg_entry_t* next_sg_entry_t;
+  sg_destroy_with(sg_list, &sg_default_allocator);
+}
+
+/*
+* sg_destroy_into Destroy a scatter-gather list made by sg_map_into
+*
+* @in sg_list   A scatter-gather list
+*
+* @note         Does nothing, the caller owns the storage. It exists so
+*               code can pair every map with a destroy.
+*/
+void sg_destroy_into(sg_entry_t* sg_list)
+{
+  (void)sg_list;
+}
 
-  while (sg_list != NULL)
+/*
+* sg_destroy_with Destroy a scatter-gather list using a given allocator
+*
+* @in sg_list   A scatter-gather list
+* @in allocator The allocator the list was built with, NULL for
+*               sg_default_allocator
+*
+* @note         The whole list is returned with a single call to the
+*               allocator, after one walk over its entries to find the
+*               tail and mark them as freed, so the cost is O(n). Lists
+*               kept in an sg_list_t are released in O(1) by
+*               sg_list_destroy.
+*/
+void sg_destroy_with(sg_entry_t* sg_list, const sg_allocator_t* allocator)
+{
+  sg_entry_t* list_tail = sg_list;
+  int num_entries = 0;
+
+  if (sg_list == NULL) return;
+  if (allocator == NULL) allocator = &sg_default_allocator;
+
+  while (list_tail != NULL)
   {
     // avoid memory access violation.
     // either an uninitialized entry, or a list which a part of it was already
     // freed
-    if ((sg_list->count <= 0) || 
-        (sg_list->next != NULL && sg_list->next->count <= 0))
+    if ((list_tail->count <= 0) || 
+        (list_tail->next != NULL && list_tail->next->count <= 0))
     {
-      sg_list->next = NULL;
+      list_tail->next = NULL;
     }
-    next_sg_entry_t = sg_list->next;
-    free(sg_list);
-    sg_list = next_sg_entry_t;
+    // mark the entry as freed for the check above
+    list_tail->count = SG_ENTRY_FREED;
+    num_entries++;
+    if (list_tail->next == NULL) break;
+    list_tail = list_tail->next;
   }
+
+  allocator->release(allocator->ctx, sg_list, list_tail, num_entries);
+  SG_STAT_ADD(entries_freed, num_entries);
+}
+
+/*
+* sg_seek       Find the entry holding a given offset into a list
+*
+* @in sg_list   A scatter-gather list
+* @in offset    Offset into the list
+* @out entry    The entry holding the byte at "offset"
+* @out intra_offset Offset of that byte inside the entry
+*
+* @ret          0 on success, -1 if the list is shorter than "offset"
+*/
+int sg_seek(sg_entry_t* sg_list, int offset, sg_entry_t** entry, int* intra_offset)
+{
+  if (offset < 0) return -1;
+
+  return sg_seek64(sg_list, (size_t)offset, entry, intra_offset);
+}
+
+/*
+* sg_seek64     Find the entry holding a given offset into a list of any size
+*
+* @in sg_list   A scatter-gather list
+* @in offset    Offset into the list
+* @out entry    The entry holding the byte at "offset"
+* @out intra_offset Offset of that byte inside the entry
+*
+* @ret          0 on success, -1 if the list is shorter than "offset"
+*/
+int sg_seek64(sg_entry_t* sg_list, size_t offset, sg_entry_t** entry, int* intra_offset)
+{
+  sg_entry_t* list_curr = sg_list;
+  size_t bytes_skipped = 0;
+  size_t entries_skipped = 0;
+
+  // skip entries (and bytes) before the offset, empty entries are skipped
+  // as well
+  while ((list_curr != NULL) &&
+         (list_curr->count <= 0 || (bytes_skipped + list_curr->count) <= offset))
+  {
+    if (list_curr->count > 0) bytes_skipped += list_curr->count;
+    list_curr = list_curr->next;
+    entries_skipped++;
+  }
+  SG_STAT_ADD(seek_entries, entries_skipped);
+
+  // check if the list exists and if the offset is smaller than the total
+  // number of available bytes
+  if (list_curr == NULL) return -1;
+
+  *entry = list_curr;
+  *intra_offset = (int)(offset - bytes_skipped);
+
+  return 0;
 }
 
 /*
@@ -136,112 +509,552 @@ void sg_destroy(sg_entry_t* sg_list)
 */
 int sg_copy(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count)
 {
-  sg_entry_t* src_curr = src;
-  sg_entry_t* dest_curr = dest;
-  int bytes_copied = 0;
-  int bytes_skipped = 0;
-  int remaining_bytes_to_copy = count;
-  int offset_in_src_entry;
-  int offset_in_dest_entry;
+  // no bytes are copied if one of the parameters is illogical
+  if (src_offset < 0) return 0;
+  if (count <= 0) return 0;
+
+  return (int)sg_copy64(src, dest, (size_t)src_offset, (size_t)count);
+}
+
+/*
+* sg_copy64     Copy bytes of any size using scatter-gather lists
+*
+* @in src       Source sg list
+* @in dest      Destination sg list
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy, for lists of 2 GiB and more.
+*/
+size_t sg_copy64(sg_entry_t* src, sg_entry_t* dest, size_t src_offset, size_t count)
+{
+  sg_cursor_t src_cursor;
+  sg_cursor_t dest_cursor;
 
   // no bytes are copied if one of the parameters is illogical
   if (dest == NULL) return 0;
-  if (src_offset < 0) return 0;
+  if (count == 0) return 0;
+
+  // check if the src exists and if the offset is smaller than the total number
+  // of available bytes. if not, no bytes are copied
+  if (sg_cursor_init64(&src_cursor, src, src_offset) != 0)
+  {
+    SG_STAT_ADD(short_copies, 1);
+    return 0;
+  }
+  // src_cursor now points to the entry from which the first byte is copied
+
+  dest_cursor.entry = dest;
+  dest_cursor.offset = 0;
+
+  return sg_copy_from_cursor64(&src_cursor, &dest_cursor, count);
+}
+
+/*
+* sg_copy_at    Copy bytes between given source and destination entries
+*
+* @in src_entry Source entry holding the first byte to copy
+* @in offset_in_src_entry Offset of the first byte inside "src_entry"
+* @in dest_entry Destination entry receiving the first byte
+* @in offset_in_dest_entry Offset of that byte inside "dest_entry"
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy once the source offset has been found,
+*               e.g. by sg_seek or sg_index_seek.
+*/
+int sg_copy_at(sg_entry_t* src_entry, int offset_in_src_entry,
+               sg_entry_t* dest_entry, int offset_in_dest_entry, int count)
+{
+  sg_cursor_t src_cursor;
+  sg_cursor_t dest_cursor;
+
+  src_cursor.entry = src_entry;
+  src_cursor.offset = offset_in_src_entry;
+  dest_cursor.entry = dest_entry;
+  dest_cursor.offset = offset_in_dest_entry;
+
+  return sg_copy_from_cursor(&src_cursor, &dest_cursor, count);
+}
+
+/*
+* sg_cursor_init Place a cursor at a given offset into a list
+*
+* @out cursor   Cursor to initialize
+* @in sg_list   A scatter-gather list
+* @in offset    Offset into the list
+*
+* @ret          0 on success, -1 if the list is shorter than "offset"
+*/
+int sg_cursor_init(sg_cursor_t* cursor, sg_entry_t* sg_list, int offset)
+{
+  if (cursor == NULL) return -1;
+
+  if (offset < 0)
+  {
+    cursor->entry = NULL;
+    cursor->offset = 0;
+    return -1;
+  }
+
+  return sg_cursor_init64(cursor, sg_list, (size_t)offset);
+}
+
+/*
+* sg_cursor_init64 Place a cursor at a given offset into a list of any size
+*
+* @out cursor   Cursor to initialize
+* @in sg_list   A scatter-gather list
+* @in offset    Offset into the list
+*
+* @ret          0 on success, -1 if the list is shorter than "offset"
+*/
+int sg_cursor_init64(sg_cursor_t* cursor, sg_entry_t* sg_list, size_t offset)
+{
+  if (cursor == NULL) return -1;
+
+  if (sg_seek64(sg_list, offset, &cursor->entry, &cursor->offset) != 0)
+  {
+    cursor->entry = NULL;
+    cursor->offset = 0;
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+* sg_cursor_normalize Move a cursor off the end of its entry
+*
+* @in cursor    A cursor
+*
+* @note         After this the cursor's entry holds the next byte, or
+*               is NULL at the end of the list.
+*/
+static void sg_cursor_normalize(sg_cursor_t* cursor)
+{
+  while (cursor->entry != NULL && cursor->entry->count > 0 &&
+         cursor->offset >= cursor->entry->count)
+  {
+    cursor->offset -= cursor->entry->count;
+    cursor->entry = cursor->entry->next;
+  }
+}
+
+/*
+* sg_cursor_advance Move a cursor forward
+*
+* @in cursor    A cursor
+* @in count     Number of bytes to move forward
+*
+* @ret          Actual number of bytes moved, fewer at the end of the list
+*/
+int sg_cursor_advance(sg_cursor_t* cursor, int count)
+{
   if (count <= 0) return 0;
 
-  // skip entries (and bytes) before the offset
-  while ((src_curr != NULL) && ((bytes_skipped + src_curr->count) <= src_offset))
+  return (int)sg_cursor_advance64(cursor, (size_t)count);
+}
+
+/*
+* sg_cursor_advance64 Move a cursor forward by any number of bytes
+*
+* @in cursor    A cursor
+* @in count     Number of bytes to move forward
+*
+* @ret          Actual number of bytes moved, fewer at the end of the list
+*/
+size_t sg_cursor_advance64(sg_cursor_t* cursor, size_t count)
+{
+  size_t bytes_advanced = 0;
+
+  if (cursor == NULL) return 0;
+  if (count == 0) return 0;
+
+  sg_cursor_normalize(cursor);
+
+  while (cursor->entry != NULL && cursor->entry->count > 0 && bytes_advanced < count)
   {
-    bytes_skipped += src_curr->count;
-    src_curr = src_curr->next;
+    int remaining_bytes_in_entry = cursor->entry->count - cursor->offset;
+
+    if (count - bytes_advanced < (size_t)remaining_bytes_in_entry)
+    {
+      cursor->offset += (int)(count - bytes_advanced);
+      bytes_advanced = count;
+      break;
+    }
+    bytes_advanced += remaining_bytes_in_entry;
+    cursor->entry = cursor->entry->next;
+    cursor->offset = 0;
   }
 
-  // check if the src exists and if the offset is smaller than the total number
-  // of available bytes. if not, no bytes are copied
-  if (src_curr == NULL) return 0;
-  // src_curr now points to the entry from which the first byte is copied
+  return bytes_advanced;
+}
+
+/*
+* sg_copy_from_cursor Copy bytes between two cursors
+*
+* @in src       Source cursor, moved past the bytes copied
+* @in dest      Destination cursor, moved past the bytes copied
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Copying consecutive windows with the same cursors walks
+*               each list only once in total. A destination cursor placed
+*               with sg_cursor_init writes at an offset into "dest".
+*/
+int sg_copy_from_cursor(sg_cursor_t* src, sg_cursor_t* dest, int count)
+{
+  if (count <= 0) return 0;
+
+  return (int)sg_copy_from_cursor64(src, dest, (size_t)count);
+}
+
+// entries walked ahead of the copy, see sg_set_prefetch_distance
+static int sg_prefetch_distance = SG_PREFETCH_DISTANCE;
+
+/*
+* sg_set_prefetch_distance Set how far ahead the copy loops prefetch
+*
+* @in distance  Number of entries, 0 to disable prefetching
+*
+* @note         Meant to be called once at startup, before copies run.
+*               Defaults to SG_PREFETCH_DISTANCE.
+*/
+void sg_set_prefetch_distance(int distance)
+{
+  if (distance < 0) distance = 0;
+  if (distance > SG_PREFETCH_MAX_DISTANCE) distance = SG_PREFETCH_MAX_DISTANCE;
+  sg_prefetch_distance = distance;
+}
+
+/*
+* sg_get_prefetch_distance Get how far ahead the copy loops prefetch
+*
+* @ret          Number of entries, 0 if prefetching is disabled
+*/
+int sg_get_prefetch_distance(void)
+{
+  return sg_prefetch_distance;
+}
 
-  // calculate how many bytes to copy from the current source entry
-  offset_in_src_entry = src_offset - bytes_skipped;
-  offset_in_dest_entry = 0;
+/*
+* sg_copy_cursors Copy bytes between two cursors, optionally checksumming them
+*
+* @in src       Source cursor, moved past the bytes copied
+* @in dest      Destination cursor, moved past the bytes copied
+* @in count     Number of bytes to copy
+* @in crc       Running CRC32C to update with the bytes copied, or NULL
+* @in flags     SG_RUN_* flags of the copy
+*
+* @ret          Actual number of bytes copied
+*/
+static size_t sg_copy_cursors(sg_cursor_t* src, sg_cursor_t* dest, size_t count,
+                              unsigned int* crc, int flags)
+{
+  sg_entry_t* src_curr;
+  sg_entry_t* dest_curr;
+  sg_entry_t* src_ahead;
+  sg_entry_t* dest_ahead;
+  int offset_in_src_entry;
+  int offset_in_dest_entry;
+  size_t bytes_copied = 0;
+  size_t remaining_bytes_to_copy = count;
+  sg_run_t run;
+
+  // no bytes are copied if one of the parameters is illogical
+  if (src == NULL) return 0;
+  if (dest == NULL) return 0;
+  if (src->offset < 0) return 0;
+  if (dest->offset < 0) return 0;
+  if (count == 0) return 0;
+
+  sg_cursor_normalize(src);
+  sg_cursor_normalize(dest);
+  src_curr = src->entry;
+  dest_curr = dest->entry;
+  offset_in_src_entry = src->offset;
+  offset_in_dest_entry = dest->offset;
+
+  // overlaps are accumulated and copied once they stop being contiguous
+  sg_run_init(&run, crc, flags);
+
+  // the walk runs sg_prefetch_distance entries ahead on both sides
+  src_ahead = sg_prefetch_start(src_curr, sg_prefetch_distance);
+  dest_ahead = sg_prefetch_start(dest_curr, sg_prefetch_distance);
 
   while (remaining_bytes_to_copy > 0 && dest_curr != NULL && src_curr != NULL)
   {
-    void* p_src = (char*)phys_to_ptr(src_curr->paddr) + offset_in_src_entry;
-    void* p_dest = (char*)phys_to_ptr(dest_curr->paddr) + offset_in_dest_entry;
+    void* p_src;
+    void* p_dest;
     int remaining_bytes_in_src_entry;
-    int bytes_to_copy_from_src_entry;
     int remaining_bytes_in_dest_entry;
-    int bytes_to_copy_to_dest_entry;
+    int bytes_to_copy;
 
     if (src_curr->count <= 0) break;
     if (dest_curr->count <= 0) break;
-    
-    remaining_bytes_in_src_entry = src_curr->count - offset_in_src_entry;
-    bytes_to_copy_from_src_entry =
-      remaining_bytes_to_copy <= remaining_bytes_in_src_entry ?
-      remaining_bytes_to_copy : remaining_bytes_in_src_entry;
 
+    p_src = (char*)phys_to_ptr(src_curr->paddr) + offset_in_src_entry;
+    p_dest = (char*)phys_to_ptr(dest_curr->paddr) + offset_in_dest_entry;
+
+    // copy up to the end of whichever entry ends first
+    remaining_bytes_in_src_entry = src_curr->count - offset_in_src_entry;
     remaining_bytes_in_dest_entry = dest_curr->count - offset_in_dest_entry;
-    bytes_to_copy_to_dest_entry =
-      remaining_bytes_to_copy <= remaining_bytes_in_dest_entry ?
-      remaining_bytes_to_copy : remaining_bytes_in_dest_entry;
+    bytes_to_copy = remaining_bytes_in_src_entry < remaining_bytes_in_dest_entry ?
+                    remaining_bytes_in_src_entry : remaining_bytes_in_dest_entry;
+    if ((size_t)bytes_to_copy > remaining_bytes_to_copy)
+      bytes_to_copy = (int)remaining_bytes_to_copy;
 
-    if (remaining_bytes_in_src_entry < remaining_bytes_in_dest_entry) 
+    sg_run_add(&run, p_dest, p_src, bytes_to_copy);
+    // update status
+    remaining_bytes_to_copy -= bytes_to_copy;
+    bytes_copied += bytes_to_copy;
+
+    // move to the next entry on the sides that were used up
+    offset_in_src_entry += bytes_to_copy;
+    if (offset_in_src_entry == src_curr->count)
     {
-      memcpy(p_dest, p_src, bytes_to_copy_from_src_entry);
       src_curr = src_curr->next;
       offset_in_src_entry = 0;
-      offset_in_dest_entry += bytes_to_copy_from_src_entry;
-      // update status
-      remaining_bytes_to_copy -= bytes_to_copy_from_src_entry;
-      bytes_copied += bytes_to_copy_from_src_entry;
+      src_ahead = sg_prefetch_step(src_ahead);
     }
-    else if (remaining_bytes_in_src_entry > remaining_bytes_in_dest_entry)
+    offset_in_dest_entry += bytes_to_copy;
+    if (offset_in_dest_entry == dest_curr->count)
     {
-      memcpy(p_dest, p_src, bytes_to_copy_to_dest_entry);
       dest_curr = dest_curr->next;
-      offset_in_src_entry += bytes_to_copy_to_dest_entry;
-      offset_in_dest_entry = 0;
-      // update status
-      remaining_bytes_to_copy -= bytes_to_copy_to_dest_entry;
-      bytes_copied += bytes_to_copy_to_dest_entry;
-    }
-    else
-    {
-      memcpy(p_dest, p_src, bytes_to_copy_from_src_entry);
-      src_curr = src_curr->next;
-      dest_curr = dest_curr->next;
-      offset_in_src_entry = 0;
       offset_in_dest_entry = 0;
-      // update status
-      remaining_bytes_to_copy -= bytes_to_copy_from_src_entry;
-      bytes_copied += bytes_to_copy_from_src_entry;
+      dest_ahead = sg_prefetch_step(dest_ahead);
     }
   }
 
+  sg_run_flush(&run);
+  if (bytes_copied < count) SG_STAT_ADD(short_copies, 1);
+
+  src->entry = src_curr;
+  src->offset = offset_in_src_entry;
+  dest->entry = dest_curr;
+  dest->offset = offset_in_dest_entry;
+
   return bytes_copied;
 }
 
-int main(int argc, char *argv[]) 
+/*
+* sg_copy_from_cursor64 Copy any number of bytes between two cursors
+*
+* @in src       Source cursor, moved past the bytes copied
+* @in dest      Destination cursor, moved past the bytes copied
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*/
+size_t sg_copy_from_cursor64(sg_cursor_t* src, sg_cursor_t* dest, size_t count)
+{
+  return sg_copy_cursors(src, dest, count, NULL, 0);
+}
+
+/*
+* sg_copy_csum  Copy bytes using scatter-gather lists and checksum them
+*
+* @in src       Source sg list
+* @in dest      Destination sg list
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+* @inout crc    CRC32C of the preceding bytes on input, 0 to start,
+*               updated over the bytes copied
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy, each byte is read once for both the copy
+*               and the checksum.
+*/
+int sg_copy_csum(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count,
+                 unsigned int* crc)
 {
-  // example
-  int var[200];
-  int var2[200];
-  int var3[200];
+  sg_cursor_t src_cursor;
+  sg_cursor_t dest_cursor;
 
-  sg_entry_t* head = sg_map(&var, 74);
-  sg_entry_t* next = sg_map(&var2, 68);
-  sg_entry_t* dest = sg_map(&var3, 96);
+  // no bytes are copied if one of the parameters is illogical
+  if (crc == NULL) return 0;
+  if (dest == NULL) return 0;
+  if (src_offset < 0) return 0;
+  if (count <= 0) return 0;
 
-  sg_destroy(head->next);
-  head->next = next;
+  if (sg_cursor_init(&src_cursor, src, src_offset) != 0)
+  {
+    SG_STAT_ADD(short_copies, 1);
+    return 0;
+  }
 
-  int bytes_copied = sg_copy(head, dest, 6, 115);
+  dest_cursor.entry = dest;
+  dest_cursor.offset = 0;
 
-  sg_destroy(next);
-  sg_destroy(head);
-  sg_destroy(dest);
+  return (int)sg_copy_cursors(&src_cursor, &dest_cursor, (size_t)count, crc, 0);
+}
 
-  return 1;
+// copies of at least this many bytes go through sg_kernel_copy_nt
+static size_t sg_nt_threshold = SG_NT_THRESHOLD;
+
+/*
+* sg_set_nt_threshold Set the size above which sg_copy_nt streams
+*
+* @in threshold Smallest copy, in bytes, done with non-temporal stores
+*
+* @note         Meant to be called once at startup, before copies run.
+*               Defaults to SG_NT_THRESHOLD.
+*/
+void sg_set_nt_threshold(size_t threshold)
+{
+  sg_nt_threshold = threshold;
+}
+
+/*
+* sg_get_nt_threshold Get the size above which sg_copy_nt streams
+*
+* @ret          Smallest copy, in bytes, done with non-temporal stores
+*/
+size_t sg_get_nt_threshold(void)
+{
+  return sg_nt_threshold;
+}
+
+/*
+* sg_copy_nt    Copy bytes using scatter-gather lists, bypassing the cache
+*
+* @in src       Source sg list
+* @in dest      Destination sg list
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy. Copies of sg_get_nt_threshold() bytes or
+*               more write the destination with non-temporal stores and
+*               prefetch the source ahead, so they do not evict the cache.
+*               Smaller copies are done as by sg_copy.
+*/
+int sg_copy_nt(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count)
+{
+  sg_cursor_t src_cursor;
+  sg_cursor_t dest_cursor;
+
+  // no bytes are copied if one of the parameters is illogical
+  if (dest == NULL) return 0;
+  if (src_offset < 0) return 0;
+  if (count <= 0) return 0;
+
+  if (sg_cursor_init(&src_cursor, src, src_offset) != 0)
+  {
+    SG_STAT_ADD(short_copies, 1);
+    return 0;
+  }
+
+  dest_cursor.entry = dest;
+  dest_cursor.offset = 0;
+
+  return (int)sg_copy_cursors(&src_cursor, &dest_cursor, (size_t)count, NULL,
+                              (size_t)count >= sg_nt_threshold ? SG_RUN_NT : 0);
+}
+
+/*
+* sg_copy_flat  Copy bytes between a list and a contiguous buffer
+*
+* @in sg_list   A scatter-gather list
+* @in offset    Offset into the list
+* @in flat      Contiguous buffer
+* @in length    Number of bytes to copy
+* @in to_flat   Non-zero to copy from the list into "flat", zero for the
+*               reverse
+*
+* @ret          Actual number of bytes copied
+*/
+static size_t sg_copy_flat(sg_entry_t* sg_list, size_t offset, char* flat,
+                           size_t length, int to_flat)
+{
+  sg_entry_t* list_curr;
+  sg_entry_t* list_ahead;
+  int offset_in_entry;
+  size_t bytes_copied = 0;
+  sg_run_t run;
+
+  // no bytes are copied if one of the parameters is illogical
+  if (flat == NULL) return 0;
+  if (length == 0) return 0;
+
+  if (sg_seek64(sg_list, offset, &list_curr, &offset_in_entry) != 0)
+  {
+    SG_STAT_ADD(short_copies, 1);
+    return 0;
+  }
+
+  // the flat side always continues the run, so entries contiguous in
+  // memory are copied together
+  sg_run_init(&run, NULL, 0);
+  list_ahead = sg_prefetch_start(list_curr, sg_prefetch_distance);
+
+  while (bytes_copied < length && list_curr != NULL && list_curr->count > 0)
+  {
+    char* p_entry = (char*)phys_to_ptr(list_curr->paddr) + offset_in_entry;
+    int bytes_to_copy = list_curr->count - offset_in_entry;
+
+    if ((size_t)bytes_to_copy > length - bytes_copied)
+      bytes_to_copy = (int)(length - bytes_copied);
+
+    if (to_flat)
+      sg_run_add(&run, flat + bytes_copied, p_entry, bytes_to_copy);
+    else
+      sg_run_add(&run, p_entry, flat + bytes_copied, bytes_to_copy);
+    bytes_copied += bytes_to_copy;
+
+    list_curr = list_curr->next;
+    offset_in_entry = 0;
+    list_ahead = sg_prefetch_step(list_ahead);
+  }
+
+  sg_run_flush(&run);
+  if (bytes_copied < length) SG_STAT_ADD(short_copies, 1);
+
+  return bytes_copied;
+}
+
+/*
+* sg_gather     Copy bytes from a scatter-gather list into a flat buffer
+*
+* @in src       Source sg list
+* @in offset    Offset into source
+* @in dst       Destination buffer
+* @in length    Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy into a list mapping "dst", without building
+*               that list: nothing is allocated and each run of contiguous
+*               source entries is copied with a single call.
+*/
+size_t sg_gather(sg_entry_t* src, size_t offset, void* dst, size_t length)
+{
+  return sg_copy_flat(src, offset, (char*)dst, length, 1);
+}
+
+/*
+* sg_scatter    Copy bytes from a flat buffer into a scatter-gather list
+*
+* @in src       Source buffer
+* @in length    Number of bytes to copy
+* @in dest      Destination sg list
+* @in dest_offset Offset into destination
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy from a list mapping "src", without building
+*               that list: nothing is allocated and each run of contiguous
+*               destination entries is written with a single call.
+*/
+size_t sg_scatter(const void* src, size_t length, sg_entry_t* dest,
+                  size_t dest_offset)
+{
+  return sg_copy_flat(dest, dest_offset, (char*)src, length, 0);
 }
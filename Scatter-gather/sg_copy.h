@@ -1,5 +1,16 @@
+#ifndef SG_COPY_H
+#define SG_COPY_H
+
+#include <stddef.h>
+#include <string.h>
+#include "sg_port.h"
 
 #define PAGE_SIZE 32
+#define PAGE_SHIFT 5	/* log2(PAGE_SIZE) */
+
+#define SG_NT_THRESHOLD (1 << 20)	/* default sg_copy_nt streaming threshold */
+
+#define SG_ENTRY_FREED (-1)	/* count of the entries of a destroyed list */
 
 typedef unsigned long physaddr_t;	/* physical address type */
 
@@ -8,7 +19,9 @@ typedef unsigned long physaddr_t;	/* physical address type */
  *
  * Note: paddr refers to the physical address of the mapped memory
  * paddr does not have to be aligned on PAGE_SIZE,
- * count must not cross PAGE_SIZE boundaries
+ * count must not cross PAGE_SIZE boundaries, or the page boundaries of
+ * the sg_geom_t the entry was mapped with. Destroying a list sets the
+ * count of its entries to SG_ENTRY_FREED, an empty entry has a count of 0
  */
 typedef struct sg_entry_s sg_entry_t;
 struct sg_entry_s {
@@ -17,6 +30,34 @@ struct sg_entry_s {
 	struct sg_entry_s *next;
 };
 
+/*
+ * Scatter-gather mapping geometry
+ *
+ * Note: page_size is the largest number of bytes one entry maps, and
+ * every entry after the first one starts on a page_size boundary of the
+ * mapped buffer. For the default geometry, page_size is PAGE_SIZE and
+ * those boundaries are PAGE_SIZE boundaries of the physical address too.
+ * page_shift is log2(page_size) when page_size is a power of two, so the
+ * layout is computed with shifts and masks, and -1 otherwise
+ */
+typedef struct sg_geom_s sg_geom_t;
+struct sg_geom_s {
+	int page_size;                  /* largest number of bytes per entry */
+	int page_shift;                 /* log2(page_size), -1 if not a power of two */
+};
+
+/*
+ * Scatter-gather list cursor
+ *
+ * Note: a position inside a list, the next byte is at "offset" inside
+ * "entry". entry is NULL once the cursor has moved past the last byte
+ */
+typedef struct sg_cursor_s sg_cursor_t;
+struct sg_cursor_s {
+	sg_entry_t *entry;              /* entry holding the next byte */
+	int offset;                     /* offset of the next byte inside entry */
+};
+
 /*
  * ptr_to_phys   Maps a pointer into a physaddr_t
  *
@@ -24,7 +65,7 @@ struct sg_entry_s {
  *
  * @ret          Physical address
  */
-static _inline physaddr_t ptr_to_phys(void *p)
+static SG_INLINE physaddr_t ptr_to_phys(void *p)
 {
 	physaddr_t paddr = (physaddr_t)p;
 	return paddr ^ ~(PAGE_SIZE-1);
@@ -37,11 +78,22 @@ static _inline physaddr_t ptr_to_phys(void *p)
  *
  * @ret          Pointer
  */
-static _inline void * phys_to_ptr(physaddr_t paddr)
+static SG_INLINE void * phys_to_ptr(physaddr_t paddr)
 {
 	return (void *)(paddr ^ ~(PAGE_SIZE-1));
 }
 
+/*
+ * init_entry    Initialize an entry in a scatter-gather list
+ *
+ * @in entry     Entry to initialize
+ * @in paddr     Physical address of the initialized entry
+ * @in count     The number of bytes in the initialized entry
+ * @in next_entry Pointer to the next entry is the scatter-gather list
+ */
+extern void init_entry(sg_entry_t *entry, physaddr_t paddr, int count,
+                       sg_entry_t *next_entry);
+
 /*
  * sg_map        Map a memory buffer using a scatter-gather list
  *
@@ -57,6 +109,104 @@ static _inline void * phys_to_ptr(physaddr_t paddr)
  */
 extern sg_entry_t *sg_map(void *buf, int length);
 
+/*
+ * sg_map64      Map a memory buffer of any size using a scatter-gather list
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ *
+ * @ret          A list of sg_entry elements mapping the input buffer
+ *
+ * @note         Same as sg_map, for buffers of 2 GiB and more.
+ */
+extern sg_entry_t *sg_map64(void *buf, size_t length);
+
+/*
+ * sg_map_into   Map a memory buffer into caller-provided entries
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ * @in entries   Array of entries to fill, e.g. on the stack
+ * @in capacity  Number of entries in the array
+ *
+ * @ret          The number of entries the mapping needs, 0 on illegal
+ *               parameters
+ *
+ * @note         Same entries as sg_map, linked in array order starting
+ *               from entries[0]. Nothing is written when the array holds
+ *               fewer entries than the returned number. The list must
+ *               not be passed to sg_destroy, see sg_destroy_into.
+ */
+extern int sg_map_into(void *buf, int length, sg_entry_t *entries, int capacity);
+
+/*
+ * sg_map_layout Compute how a buffer is split into scatter-gather entries
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes, positive
+ * @out head_count Number of bytes in the first entry
+ * @out num_full_pages Number of full PAGE_SIZE entries after the first one
+ * @out tail_count Number of bytes in the last, partial entry, 0 if none
+ *
+ * @ret          The total number of entries
+ *
+ * @note         The first entry runs up to the first PAGE_SIZE boundary,
+ *               or is a full page if the buffer is already aligned.
+ */
+extern int sg_map_layout(void *buf, int length, int *head_count,
+                         int *num_full_pages, int *tail_count);
+
+/*
+ * sg_geom_init  Initialize a mapping geometry
+ *
+ * @out geom     Geometry to initialize
+ * @in page_size Largest number of bytes per entry, positive
+ *
+ * @ret          0 on success, -1 on illegal parameters
+ */
+extern int sg_geom_init(sg_geom_t *geom, int page_size);
+
+/*
+ * sg_default_geom The PAGE_SIZE geometry used by sg_map
+ */
+extern const sg_geom_t sg_default_geom;
+
+/*
+ * sg_map_layout_geom Compute how a buffer is split into entries of a geometry
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes, positive
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ * @out head_count Number of bytes in the first entry
+ * @out num_full_pages Number of full page entries after the first one
+ * @out tail_count Number of bytes in the last, partial entry, 0 if none
+ *
+ * @ret          The total number of entries
+ *
+ * @note         Same as sg_map_layout with geom->page_size pages.
+ */
+extern int sg_map_layout_geom(void *buf, int length, const sg_geom_t *geom,
+                              int *head_count, int *num_full_pages,
+                              int *tail_count);
+
+/*
+ * sg_map_layout64 Compute how a buffer of any size is split into entries
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes, positive
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ * @out head_count Number of bytes in the first entry
+ * @out num_full_pages Number of full page entries after the first one
+ * @out tail_count Number of bytes in the last, partial entry, 0 if none
+ *
+ * @ret          The total number of entries
+ *
+ * @note         Same as sg_map_layout_geom, for buffers of 2 GiB and more.
+ */
+extern size_t sg_map_layout64(void *buf, size_t length, const sg_geom_t *geom,
+                              int *head_count, size_t *num_full_pages,
+                              int *tail_count);
+
 /*
  * sg_destroy    Destroy a scatter-gather list
  *
@@ -64,6 +214,16 @@ extern sg_entry_t *sg_map(void *buf, int length);
  */
 extern void sg_destroy(sg_entry_t *sg_list);
 
+/*
+ * sg_destroy_into Destroy a scatter-gather list made by sg_map_into
+ *
+ * @in sg_list   A scatter-gather list
+ *
+ * @note         Does nothing, the caller owns the storage. It exists so
+ *               code can pair every map with a destroy.
+ */
+extern void sg_destroy_into(sg_entry_t *sg_list);
+
 /*
  * sg_copy       Copy bytes using scatter-gather lists
  *
@@ -78,6 +238,239 @@ extern void sg_destroy(sg_entry_t *sg_list);
  *               starting from "src_offset" into the beginning of "dest".
  *               The scatter gather list can be of arbitrary length so it is
  *               possible that fewer bytes can be copied.
- *               The function returns the actual number of bytes copied
+ *               The function returns the actual number of bytes copied.
+ *               "src" carries no index, so "src_offset" is found by
+ *               walking it with sg_seek. A list copied from many times
+ *               should be indexed once and copied with sg_copy_indexed.
  */
 extern int sg_copy(sg_entry_t *src, sg_entry_t *dest, int src_offset, int count);
+
+/*
+ * sg_copy64     Copy bytes of any size using scatter-gather lists
+ *
+ * @in src       Source sg list
+ * @in dest      Destination sg list
+ * @in src_offset Offset into source
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy, for lists of 2 GiB and more.
+ */
+extern size_t sg_copy64(sg_entry_t *src, sg_entry_t *dest, size_t src_offset,
+                        size_t count);
+
+/*
+ * sg_copy_nt    Copy bytes using scatter-gather lists, bypassing the cache
+ *
+ * @in src       Source sg list
+ * @in dest      Destination sg list
+ * @in src_offset Offset into source
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy. Copies of sg_get_nt_threshold() bytes or
+ *               more write the destination with non-temporal stores and
+ *               prefetch the source ahead, so they do not evict the cache.
+ *               Smaller copies are done as by sg_copy.
+ */
+extern int sg_copy_nt(sg_entry_t *src, sg_entry_t *dest, int src_offset, int count);
+
+/*
+ * sg_set_nt_threshold Set the size above which sg_copy_nt streams
+ *
+ * @in threshold Smallest copy, in bytes, done with non-temporal stores
+ *
+ * @note         Meant to be called once at startup, before copies run.
+ *               Defaults to SG_NT_THRESHOLD.
+ */
+extern void sg_set_nt_threshold(size_t threshold);
+
+/*
+ * sg_get_nt_threshold Get the size above which sg_copy_nt streams
+ *
+ * @ret          Smallest copy, in bytes, done with non-temporal stores
+ */
+extern size_t sg_get_nt_threshold(void);
+
+/*
+ * sg_gather     Copy bytes from a scatter-gather list into a flat buffer
+ *
+ * @in src       Source sg list
+ * @in offset    Offset into source
+ * @in dst       Destination buffer
+ * @in length    Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy into a list mapping "dst", without building
+ *               that list: nothing is allocated and each run of contiguous
+ *               source entries is copied with a single call.
+ */
+extern size_t sg_gather(sg_entry_t *src, size_t offset, void *dst, size_t length);
+
+/*
+ * sg_scatter    Copy bytes from a flat buffer into a scatter-gather list
+ *
+ * @in src       Source buffer
+ * @in length    Number of bytes to copy
+ * @in dest      Destination sg list
+ * @in dest_offset Offset into destination
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy from a list mapping "src", without building
+ *               that list: nothing is allocated and each run of contiguous
+ *               destination entries is written with a single call.
+ */
+extern size_t sg_scatter(const void *src, size_t length, sg_entry_t *dest,
+                         size_t dest_offset);
+
+/*
+ * sg_copy_fast  Copy bytes using scatter-gather lists, inlined for small copies
+ *
+ * @in src       Source sg list
+ * @in dest      Destination sg list
+ * @in src_offset Offset into source
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy. When the bytes to copy lie in the first
+ *               entry of both lists they are copied in place, otherwise
+ *               the call falls back to sg_copy. Builds with SG_STATS
+ *               always call sg_copy, so that every copy is counted.
+ */
+static SG_INLINE int sg_copy_fast(sg_entry_t *src, sg_entry_t *dest, int src_offset, int count)
+{
+#if !defined(SG_STATS)
+	if (src != NULL && dest != NULL && count > 0 &&
+	    src_offset >= 0 && src_offset < src->count &&
+	    count <= src->count - src_offset && count <= dest->count) {
+		memcpy(phys_to_ptr(dest->paddr),
+		       (char *)phys_to_ptr(src->paddr) + src_offset, count);
+		return count;
+	}
+#endif
+
+	return sg_copy(src, dest, src_offset, count);
+}
+
+/*
+ * sg_seek       Find the entry holding a given offset into a list
+ *
+ * @in sg_list   A scatter-gather list
+ * @in offset    Offset into the list
+ * @out entry    The entry holding the byte at "offset"
+ * @out intra_offset Offset of that byte inside the entry
+ *
+ * @ret          0 on success, -1 if the list is shorter than "offset"
+ *
+ * @note         Walks the list from its head, as sg_copy does. See
+ *               sg_index_seek for lookups in O(log n).
+ */
+extern int sg_seek(sg_entry_t *sg_list, int offset, sg_entry_t **entry,
+                   int *intra_offset);
+
+/*
+ * sg_seek64     Find the entry holding a given offset into a list of any size
+ *
+ * @in sg_list   A scatter-gather list
+ * @in offset    Offset into the list
+ * @out entry    The entry holding the byte at "offset"
+ * @out intra_offset Offset of that byte inside the entry
+ *
+ * @ret          0 on success, -1 if the list is shorter than "offset"
+ */
+extern int sg_seek64(sg_entry_t *sg_list, size_t offset, sg_entry_t **entry,
+                     int *intra_offset);
+
+/*
+ * sg_copy_at    Copy bytes between given source and destination entries
+ *
+ * @in src_entry Source entry holding the first byte to copy
+ * @in offset_in_src_entry Offset of the first byte inside "src_entry"
+ * @in dest_entry Destination entry receiving the first byte
+ * @in offset_in_dest_entry Offset of that byte inside "dest_entry"
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy once the source offset has been found,
+ *               e.g. by sg_seek or sg_index_seek.
+ */
+extern int sg_copy_at(sg_entry_t *src_entry, int offset_in_src_entry,
+                      sg_entry_t *dest_entry, int offset_in_dest_entry,
+                      int count);
+
+/*
+ * sg_cursor_init Place a cursor at a given offset into a list
+ *
+ * @out cursor   Cursor to initialize
+ * @in sg_list   A scatter-gather list
+ * @in offset    Offset into the list
+ *
+ * @ret          0 on success, -1 if the list is shorter than "offset"
+ */
+extern int sg_cursor_init(sg_cursor_t *cursor, sg_entry_t *sg_list, int offset);
+
+/*
+ * sg_cursor_init64 Place a cursor at a given offset into a list of any size
+ *
+ * @out cursor   Cursor to initialize
+ * @in sg_list   A scatter-gather list
+ * @in offset    Offset into the list
+ *
+ * @ret          0 on success, -1 if the list is shorter than "offset"
+ */
+extern int sg_cursor_init64(sg_cursor_t *cursor, sg_entry_t *sg_list, size_t offset);
+
+/*
+ * sg_cursor_advance Move a cursor forward
+ *
+ * @in cursor    A cursor
+ * @in count     Number of bytes to move forward
+ *
+ * @ret          Actual number of bytes moved, fewer at the end of the list
+ */
+extern int sg_cursor_advance(sg_cursor_t *cursor, int count);
+
+/*
+ * sg_cursor_advance64 Move a cursor forward by any number of bytes
+ *
+ * @in cursor    A cursor
+ * @in count     Number of bytes to move forward
+ *
+ * @ret          Actual number of bytes moved, fewer at the end of the list
+ */
+extern size_t sg_cursor_advance64(sg_cursor_t *cursor, size_t count);
+
+/*
+ * sg_copy_from_cursor Copy bytes between two cursors
+ *
+ * @in src       Source cursor, moved past the bytes copied
+ * @in dest      Destination cursor, moved past the bytes copied
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Copying consecutive windows with the same cursors walks
+ *               each list only once in total. A destination cursor placed
+ *               with sg_cursor_init writes at an offset into "dest".
+ */
+extern int sg_copy_from_cursor(sg_cursor_t *src, sg_cursor_t *dest, int count);
+
+/*
+ * sg_copy_from_cursor64 Copy any number of bytes between two cursors
+ *
+ * @in src       Source cursor, moved past the bytes copied
+ * @in dest      Destination cursor, moved past the bytes copied
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ */
+extern size_t sg_copy_from_cursor64(sg_cursor_t *src, sg_cursor_t *dest,
+                                    size_t count);
+
+#endif /* SG_COPY_H */
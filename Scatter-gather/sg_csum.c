@@ -0,0 +1,284 @@
+#include <stddef.h>
+#include <string.h>
+#include "sg_csum.h"
+#include "sg_port.h"
+#include "sg_stats.h"
+
+#if defined(SG_ARCH_X86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define SG_ARCH_CRC32 1
+#endif
+
+#define SG_CRC32C_POLY 0x82f63b78u	/* reflected Castagnoli polynomial */
+
+/*
+* CRC kernels
+*
+* Note: both work on the raw CRC register, the caller inverts it before
+* and after. The copy kernel stores to dest what it checksums
+*/
+typedef unsigned int (*sg_crc_fn)(unsigned int crc, const unsigned char* buf, size_t length);
+typedef unsigned int (*sg_crc_copy_fn)(unsigned int crc, unsigned char* dest,
+                                       const unsigned char* src, size_t length);
+
+static unsigned int sg_crc_table[256];
+
+static void sg_crc_table_init(void)
+{
+  unsigned int i;
+  int j;
+
+  for (i = 0; i < 256; i++)
+  {
+    unsigned int crc = i;
+
+    for (j = 0; j < 8; j++)
+    {
+      crc = (crc >> 1) ^ (SG_CRC32C_POLY & (0u - (crc & 1)));
+    }
+    sg_crc_table[i] = crc;
+  }
+}
+
+static unsigned int sg_crc_generic(unsigned int crc, const unsigned char* buf, size_t length)
+{
+  size_t i;
+
+  for (i = 0; i < length; i++)
+  {
+    crc = sg_crc_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+  }
+
+  return crc;
+}
+
+static unsigned int sg_crc_copy_generic(unsigned int crc, unsigned char* dest,
+                                        const unsigned char* src, size_t length)
+{
+  size_t i;
+
+  for (i = 0; i < length; i++)
+  {
+    dest[i] = src[i];
+    crc = sg_crc_table[(crc ^ src[i]) & 0xff] ^ (crc >> 8);
+  }
+
+  return crc;
+}
+
+#if defined(SG_ARCH_X86)
+#if defined(_M_X64) || defined(__x86_64__)
+typedef unsigned long long sg_crc_word_t;
+#define SG_CRC_WORD(crc, w) ((unsigned int)_mm_crc32_u64((crc), (w)))
+#else
+typedef unsigned int sg_crc_word_t;
+#define SG_CRC_WORD(crc, w) _mm_crc32_u32((crc), (w))
+#endif
+#define SG_CRC_BYTE(crc, b) _mm_crc32_u8((crc), (b))
+#define SG_CRC_TARGET SG_TARGET("sse4.2")
+#elif defined(SG_ARCH_CRC32)
+typedef unsigned long long sg_crc_word_t;
+#define SG_CRC_WORD(crc, w) __crc32cd((crc), (w))
+#define SG_CRC_BYTE(crc, b) __crc32cb((crc), (b))
+#define SG_CRC_TARGET
+#endif
+
+#if defined(SG_CRC_WORD)
+SG_CRC_TARGET
+static unsigned int sg_crc_hw(unsigned int crc, const unsigned char* buf, size_t length)
+{
+  sg_crc_word_t w;
+
+  // memcpy of a word compiles to an unaligned load
+  for (; length >= sizeof(w); length -= sizeof(w), buf += sizeof(w))
+  {
+    memcpy(&w, buf, sizeof(w));
+    crc = SG_CRC_WORD(crc, w);
+  }
+  for (; length > 0; length--, buf++)
+  {
+    crc = SG_CRC_BYTE(crc, *buf);
+  }
+
+  return crc;
+}
+
+SG_CRC_TARGET
+static unsigned int sg_crc_copy_hw(unsigned int crc, unsigned char* dest,
+                                   const unsigned char* src, size_t length)
+{
+  sg_crc_word_t w;
+
+  for (; length >= sizeof(w); length -= sizeof(w), src += sizeof(w), dest += sizeof(w))
+  {
+    memcpy(&w, src, sizeof(w));
+    crc = SG_CRC_WORD(crc, w);
+    memcpy(dest, &w, sizeof(w));
+  }
+  for (; length > 0; length--, src++, dest++)
+  {
+    *dest = *src;
+    crc = SG_CRC_BYTE(crc, *src);
+  }
+
+  return crc;
+}
+#endif
+
+#if defined(SG_ARCH_X86)
+/*
+* sg_cpu_has_sse42 Tell whether the CPU has the SSE4.2 CRC32 instruction
+*
+* @ret          Non-zero if SSE4.2 is supported
+*/
+static int sg_cpu_has_sse42(void)
+{
+#if defined(_MSC_VER)
+  int info[4];
+
+  __cpuid(info, 0);
+  if (info[0] < 1) return 0;
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+static unsigned int sg_crc_resolve(unsigned int crc, const unsigned char* buf, size_t length);
+static unsigned int sg_crc_copy_resolve(unsigned int crc, unsigned char* dest,
+                                        const unsigned char* src, size_t length);
+
+static sg_crc_fn sg_crc = sg_crc_resolve;
+static sg_crc_copy_fn sg_crc_copy = sg_crc_copy_resolve;
+
+/*
+* sg_crc_select Pick the CRC kernels for this CPU
+*
+* @note         Every thread picks the same kernels, so racing calls are
+*               harmless.
+*/
+static void sg_crc_select(void)
+{
+  sg_crc_fn crc = sg_crc_generic;
+  sg_crc_copy_fn crc_copy = sg_crc_copy_generic;
+
+#if defined(SG_ARCH_X86)
+  if (sg_cpu_has_sse42())
+  {
+    crc = sg_crc_hw;
+    crc_copy = sg_crc_copy_hw;
+  }
+#elif defined(SG_ARCH_CRC32)
+  crc = sg_crc_hw;
+  crc_copy = sg_crc_copy_hw;
+#endif
+
+  // the table must be ready before the generic kernels are published
+  if (crc == sg_crc_generic) sg_crc_table_init();
+  sg_crc_copy = crc_copy;
+  sg_crc = crc;
+}
+
+static unsigned int sg_crc_resolve(unsigned int crc, const unsigned char* buf, size_t length)
+{
+  sg_crc_select();
+  return sg_crc(crc, buf, length);
+}
+
+static unsigned int sg_crc_copy_resolve(unsigned int crc, unsigned char* dest,
+                                        const unsigned char* src, size_t length)
+{
+  sg_crc_select();
+  return sg_crc_copy(crc, dest, src, length);
+}
+
+/*
+* sg_crc32c     Update a CRC32C over a buffer
+*
+* @in crc       CRC of the preceding bytes, 0 to start
+* @in buf       Buffer
+* @in length    Number of bytes in the buffer
+*
+* @ret          CRC including the buffer
+*/
+unsigned int sg_crc32c(unsigned int crc, const void* buf, size_t length)
+{
+  if (length == 0) return crc;
+
+  return ~sg_crc(~crc, (const unsigned char*)buf, length);
+}
+
+/*
+* sg_crc32c_copy Copy a buffer and update a CRC32C over it in one pass
+*
+* @in dest      Destination
+* @in src       Source
+* @in length    Number of bytes to copy
+* @in crc       CRC of the preceding bytes, 0 to start
+*
+* @ret          CRC including the bytes copied
+*/
+unsigned int sg_crc32c_copy(void* dest, const void* src, size_t length, unsigned int crc)
+{
+  if (length == 0) return crc;
+  SG_STAT_COPY(length);
+
+  return ~sg_crc_copy(~crc, (unsigned char*)dest, (const unsigned char*)src, length);
+}
+
+/*
+* sg_csum       Compute the CRC32C of a range of a scatter-gather list
+*
+* @in sg_list   A scatter-gather list
+* @in offset    Offset of the range into the list
+* @in length    Number of bytes in the range
+*
+* @ret          CRC32C of the range, or of the bytes of the range that
+*               are inside the list if it is shorter
+*
+* @note         The list is walked once, the CRCs of its segments are
+*               chained.
+*/
+unsigned int sg_csum(sg_entry_t* sg_list, int offset, int length)
+{
+  sg_entry_t* list_curr;
+  int offset_in_entry;
+  unsigned int crc = 0;
+  const char* seg_base = NULL;
+  size_t seg_len = 0;
+
+  if (offset < 0 || length <= 0) return 0;
+  if (sg_seek(sg_list, offset, &list_curr, &offset_in_entry) != 0) return 0;
+
+  // contiguous entries are checksummed together
+  for (; list_curr != NULL && list_curr->count > 0 && length > 0;
+       list_curr = list_curr->next)
+  {
+    const char* p = (const char*)phys_to_ptr(list_curr->paddr) + offset_in_entry;
+    int bytes = list_curr->count - offset_in_entry;
+
+    if (bytes > length) bytes = length;
+    if (seg_len > 0 && seg_base + seg_len != p)
+    {
+      crc = sg_crc32c(crc, seg_base, seg_len);
+      seg_len = 0;
+    }
+    if (seg_len == 0) seg_base = p;
+    seg_len += bytes;
+    length -= bytes;
+    offset_in_entry = 0;
+  }
+  crc = sg_crc32c(crc, seg_base, seg_len);
+
+  return crc;
+}
@@ -0,0 +1,75 @@
+#ifndef SG_CSUM_H
+#define SG_CSUM_H
+
+#include <stddef.h>
+#include "sg_copy.h"
+
+/*
+ * CRC32C checksums
+ *
+ * Note: the Castagnoli CRC used by iSCSI, ext4 and most storage
+ * formats, computed with the SSE4.2 or ARMv8 CRC instructions when the
+ * CPU has them. Every function takes the CRC of the bytes before the
+ * ones it is given, 0 for the first bytes, and returns the CRC
+ * including them. Checksums of consecutive segments are combined by
+ * passing the result of one call to the next one
+ */
+
+/*
+ * sg_crc32c     Update a CRC32C over a buffer
+ *
+ * @in crc       CRC of the preceding bytes, 0 to start
+ * @in buf       Buffer
+ * @in length    Number of bytes in the buffer
+ *
+ * @ret          CRC including the buffer
+ */
+extern unsigned int sg_crc32c(unsigned int crc, const void *buf, size_t length);
+
+/*
+ * sg_crc32c_copy Copy a buffer and update a CRC32C over it in one pass
+ *
+ * @in dest      Destination
+ * @in src       Source
+ * @in length    Number of bytes to copy
+ * @in crc       CRC of the preceding bytes, 0 to start
+ *
+ * @ret          CRC including the bytes copied
+ */
+extern unsigned int sg_crc32c_copy(void *dest, const void *src, size_t length,
+                                   unsigned int crc);
+
+/*
+ * sg_csum       Compute the CRC32C of a range of a scatter-gather list
+ *
+ * @in sg_list   A scatter-gather list
+ * @in offset    Offset of the range into the list
+ * @in length    Number of bytes in the range
+ *
+ * @ret          CRC32C of the range, or of the bytes of the range that
+ *               are inside the list if it is shorter
+ *
+ * @note         The list is walked once, the CRCs of its segments are
+ *               chained.
+ */
+extern unsigned int sg_csum(sg_entry_t *sg_list, int offset, int length);
+
+/*
+ * sg_copy_csum  Copy bytes using scatter-gather lists and checksum them
+ *
+ * @in src       Source sg list
+ * @in dest      Destination sg list
+ * @in src_offset Offset into source
+ * @in count     Number of bytes to copy
+ * @inout crc    CRC32C of the preceding bytes on input, 0 to start,
+ *               updated over the bytes copied
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy, each byte is read once for both the copy
+ *               and the checksum.
+ */
+extern int sg_copy_csum(sg_entry_t *src, sg_entry_t *dest, int src_offset,
+                        int count, unsigned int *crc);
+
+#endif /* SG_CSUM_H */
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include "sg_file.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+* Mapped window of a file
+*
+* Note: the window starts at the boundary preceding the requested
+* offset that the system maps from, so "addr" may lie before the first
+* mapped byte
+*/
+typedef struct sg_file_map_s {
+  void* addr;                           // start of the window
+  size_t length;                        // length of the window
+#if defined(_WIN32)
+  HANDLE mapping;                       // file mapping object
+#endif
+} sg_file_map_t;
+
+/*
+* sg_file_unmap Unmap a file window, release callback of sg_map_file
+*
+* @in ctx       The sg_file_map_t of the window
+*/
+static void sg_file_unmap(void* ctx)
+{
+  sg_file_map_t* map = (sg_file_map_t*)ctx;
+
+#if defined(_WIN32)
+  UnmapViewOfFile(map->addr);
+  CloseHandle(map->mapping);
+#else
+  munmap(map->addr, map->length);
+#endif
+  free(map);
+}
+
+/*
+* sg_file_window Map the window of a file holding a range
+*
+* @in map       Window to fill
+* @in fd        File descriptor open for reading
+* @in offset    Offset of the range into the file
+* @in length    Number of bytes in the range
+*
+* @ret          The first byte of the range, NULL on failure
+*/
+static char* sg_file_window(sg_file_map_t* map, int fd, long long offset,
+                            size_t length)
+{
+  long long window_offset;
+  size_t lead;
+#if defined(_WIN32)
+  HANDLE file = (HANDLE)_get_osfhandle(fd);
+  LARGE_INTEGER file_size;
+  SYSTEM_INFO info;
+
+  if (file == INVALID_HANDLE_VALUE) return NULL;
+  if (!GetFileSizeEx(file, &file_size)) return NULL;
+  if (offset > file_size.QuadPart || (long long)length > file_size.QuadPart - offset)
+    return NULL;
+
+  // views start on an allocation granularity boundary
+  GetSystemInfo(&info);
+  lead = (size_t)(offset % info.dwAllocationGranularity);
+  window_offset = offset - lead;
+  if (length > (size_t)-1 - lead) return NULL;
+  map->length = lead + length;
+
+  map->mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (map->mapping == NULL) return NULL;
+  map->addr = MapViewOfFile(map->mapping, FILE_MAP_READ,
+                            (DWORD)((unsigned long long)window_offset >> 32),
+                            (DWORD)window_offset, map->length);
+  if (map->addr == NULL)
+  {
+    CloseHandle(map->mapping);
+    return NULL;
+  }
+#else
+  struct stat st;
+  long page_size = sysconf(_SC_PAGESIZE);
+
+  if (page_size <= 0) return NULL;
+  if (fstat(fd, &st) != 0) return NULL;
+  // bytes past the end of the file cannot be read through a mapping
+  if (offset > (long long)st.st_size || (long long)length > (long long)st.st_size - offset)
+    return NULL;
+
+  // mappings start on a page boundary
+  lead = (size_t)(offset % page_size);
+  window_offset = offset - lead;
+  if (length > (size_t)-1 - lead) return NULL;
+  map->length = lead + length;
+
+  map->addr = mmap(NULL, map->length, PROT_READ, MAP_SHARED, fd, (off_t)window_offset);
+  if (map->addr == MAP_FAILED) return NULL;
+#endif
+
+  return (char*)map->addr + lead;
+}
+
+/*
+* sg_map_file   Map a range of a file into a scatter-gather list
+*
+* @in fd        File descriptor open for reading
+* @in offset    Offset of the range into the file
+* @in length    Number of bytes in the range, all inside the file
+* @in geom      Mapping geometry, NULL for sg_default_geom
+* @in flags     SG_FILE_* access hints, 0 for none
+*
+* @ret          A shared list mapping the range, NULL on failure
+*
+* @note         The file is memory-mapped read-only, so the entries point
+*               straight at the page cache and nothing is read until it
+*               is copied. Use the list as a copy source only. The last
+*               sg_unref of the list unmaps the file, the descriptor may
+*               be closed as soon as sg_map_file returns. The hints are
+*               passed to madvise, and ignored on Windows.
+*/
+sg_shared_t* sg_map_file(int fd, long long offset, size_t length,
+                         const sg_geom_t* geom, int flags)
+{
+  sg_file_map_t* map;
+  sg_shared_t* shared;
+  sg_list_t list;
+  char* first;
+
+  // check for illegal input parameters
+  if (fd < 0) return NULL;
+  if (offset < 0) return NULL;
+  if (length == 0) return NULL;
+
+  map = (sg_file_map_t*)malloc(sizeof(sg_file_map_t));
+  if (map == NULL) return NULL;
+
+  first = sg_file_window(map, fd, offset, length);
+  if (first == NULL)
+  {
+    free(map);
+    return NULL;
+  }
+
+#if !defined(_WIN32)
+  // hints only steer readahead, a failing one is not an error
+  if (flags & SG_FILE_SEQUENTIAL) madvise(map->addr, map->length, MADV_SEQUENTIAL);
+  if (flags & SG_FILE_WILLNEED) madvise(map->addr, map->length, MADV_WILLNEED);
+#else
+  (void)flags;
+#endif
+
+  if (sg_list_map(&list, first, length, geom, NULL) != 0)
+  {
+    sg_file_unmap(map);
+    return NULL;
+  }
+
+  shared = sg_share(&list, sg_file_unmap, map);
+  if (shared == NULL)
+  {
+    sg_list_destroy(&list);
+    sg_file_unmap(map);
+    return NULL;
+  }
+
+  return shared;
+}
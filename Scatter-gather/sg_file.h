@@ -0,0 +1,31 @@
+#ifndef SG_FILE_H
+#define SG_FILE_H
+
+#include <stddef.h>
+#include "sg_shared.h"
+
+#define SG_FILE_SEQUENTIAL 0x1	/* the mapping will be read in order */
+#define SG_FILE_WILLNEED 0x2	/* start reading the whole range in */
+
+/*
+ * sg_map_file   Map a range of a file into a scatter-gather list
+ *
+ * @in fd        File descriptor open for reading
+ * @in offset    Offset of the range into the file
+ * @in length    Number of bytes in the range, all inside the file
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ * @in flags     SG_FILE_* access hints, 0 for none
+ *
+ * @ret          A shared list mapping the range, NULL on failure
+ *
+ * @note         The file is memory-mapped read-only, so the entries point
+ *               straight at the page cache and nothing is read until it
+ *               is copied. Use the list as a copy source only. The last
+ *               sg_unref of the list unmaps the file, the descriptor may
+ *               be closed as soon as sg_map_file returns. The hints are
+ *               passed to madvise, and ignored on Windows.
+ */
+extern sg_shared_t *sg_map_file(int fd, long long offset, size_t length,
+                                const sg_geom_t *geom, int flags);
+
+#endif /* SG_FILE_H */
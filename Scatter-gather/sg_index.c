@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include "sg_index.h"
+#include "sg_stats.h"
+
+/*
+* sg_index_build Build the cumulative-offset index of a list
+*
+* @in sg_list   A scatter-gather list
+*
+* @ret          The index of the list, NULL on failure
+*
+* @note         Empty entries are skipped, as in sg_seek, so an offset is
+*               found in the same entry sg_seek finds it in.
+*/
+sg_index_t* sg_index_build(sg_entry_t* sg_list)
+{
+  sg_index_t* index;
+  sg_entry_t* list_curr;
+  int num_entries = 0;
+  int num_empty = 0;
+  int holes = 0;
+  int i;
+
+  if (sg_list == NULL) return NULL;
+
+  for (list_curr = sg_list; list_curr != NULL; list_curr = list_curr->next)
+  {
+    if (list_curr->count <= 0)
+    {
+      num_empty++;
+      continue;
+    }
+    // sg_copy stops at empty entries, only the trailing ones are harmless
+    if (num_empty > 0) holes = 1;
+    num_entries++;
+  }
+  if (num_entries == 0) return NULL;
+
+  // the index header and both arrays share one allocation
+  index = (sg_index_t*)malloc(sizeof(sg_index_t) +
+                              num_entries * sizeof(sg_entry_t*) +
+                              num_entries * sizeof(int));
+  if (index == NULL) return NULL;
+
+  index->entries = (sg_entry_t**)(index + 1);
+  index->offset = (int*)(index->entries + num_entries);
+  index->num_entries = num_entries;
+  index->length = 0;
+  index->regular = 1;
+  index->holes = holes;
+
+  list_curr = sg_list;
+  for (i = 0; i < num_entries; i++)
+  {
+    while (list_curr->count <= 0) list_curr = list_curr->next;
+
+    index->entries[i] = list_curr;
+    index->offset[i] = index->length;
+    index->length += list_curr->count;
+    list_curr = list_curr->next;
+  }
+
+  // interior entries decide whether lookups can be done arithmetically
+  index->page_size = num_entries > 1 ? index->entries[1]->count :
+                                       index->entries[0]->count;
+  for (i = 1; i < num_entries - 1; i++)
+  {
+    if (index->entries[i]->count != index->page_size) index->regular = 0;
+  }
+
+  return index;
+}
+
+/*
+* sg_index_destroy Destroy a cumulative-offset index
+*
+* @in index     An index made by sg_index_build
+*/
+void sg_index_destroy(sg_index_t* index)
+{
+  free(index);
+}
+
+/*
+* sg_offset_search Find the entry holding an offset in a prefix-sum array
+*
+* @in offset_array Offset of the first byte of each entry, ascending
+* @in num_entries Number of entries, at least one
+* @in offset    An offset, not smaller than offset_array[0]
+*
+* @ret          The last entry whose first byte is at or before "offset"
+*/
+int sg_offset_search(const int* offset_array, int num_entries, int offset)
+{
+  int low = 0;
+  int high = num_entries - 1;
+
+  // invariant: offset_array[low] <= offset, and the answer is in [low, high]
+  while (low < high)
+  {
+    int mid = low + (high - low + 1) / 2;
+
+    if (offset_array[mid] <= offset)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+
+  return low;
+}
+
+/*
+* sg_index_seek Find the entry holding a given offset using an index
+*
+* @in index     Index of a scatter-gather list
+* @in offset    Offset into the list
+* @out entry    The entry holding the byte at "offset"
+* @out intra_offset Offset of that byte inside the entry
+*
+* @ret          0 on success, -1 if the list is shorter than "offset"
+*/
+int sg_index_seek(const sg_index_t* index, int offset,
+                  sg_entry_t** entry, int* intra_offset)
+{
+  int i;
+
+  if (index == NULL) return -1;
+  if (offset < 0 || offset >= index->length) return -1;
+
+  if (index->regular)
+  {
+    // the first entry may be partial, every entry after it except the
+    // last one maps a full page
+    if (offset < index->entries[0]->count)
+    {
+      i = 0;
+    }
+    else
+    {
+      i = 1 + (offset - index->entries[0]->count) / index->page_size;
+      if (i > index->num_entries - 1) i = index->num_entries - 1;
+    }
+  }
+  else
+  {
+    i = sg_offset_search(index->offset, index->num_entries, offset);
+  }
+
+  *entry = index->entries[i];
+  *intra_offset = offset - index->offset[i];
+
+  return 0;
+}
+
+/*
+* sg_copy_indexed Copy bytes from an indexed sg list
+*
+* @in src       Index of the source sg list
+* @in dest      Destination sg list
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy, including where the copy stops at an
+*               empty entry, the source offset is found in O(log n) or
+*               O(1) instead of walking the source list.
+*/
+int sg_copy_indexed(const sg_index_t* src, sg_entry_t* dest,
+                    int src_offset, int count)
+{
+  sg_entry_t* src_curr;
+  int offset_in_src_entry;
+
+  // no bytes are copied if one of the parameters is illogical
+  if (dest == NULL) return 0;
+  if (src_offset < 0) return 0;
+  if (count <= 0) return 0;
+
+  if (sg_index_seek(src, src_offset, &src_curr, &offset_in_src_entry) != 0)
+  {
+    SG_STAT_ADD(short_copies, 1);
+    return 0;
+  }
+
+  return sg_copy_at(src_curr, offset_in_src_entry, dest, 0, count);
+}
@@ -0,0 +1,91 @@
+#ifndef SG_INDEX_H
+#define SG_INDEX_H
+
+#include "sg_copy.h"
+
+/*
+ * Cumulative-offset index of a scatter-gather list
+ *
+ * Note: offset[i] is the offset into the list of the first byte of
+ * entries[i]. When every entry except the first and the last one maps
+ * the same number of bytes, page_size, as in lists made by sg_map or
+ * sg_map_geom, "regular" is set and lookups are plain arithmetic.
+ * An index is built and owned by the caller, sg_copy never finds one
+ * on its own: copies through an index go through sg_copy_indexed.
+ * Otherwise they are a binary search. Empty entries are not indexed,
+ * "holes" tells whether some were found before an indexed entry: sg_copy
+ * stops at them, so a copy may end before index->length. The index must
+ * be rebuilt whenever the list is modified
+ */
+typedef struct sg_index_s sg_index_t;
+struct sg_index_s {
+	sg_entry_t **entries;           /* the indexed entries, in list order */
+	int *offset;                    /* offset of the first byte of each entry */
+	int num_entries;                /* number of indexed entries */
+	int length;                     /* total number of bytes in the list */
+	int regular;                    /* non-zero if interior entries are full pages */
+	int page_size;                  /* size of the interior entries if regular */
+	int holes;                      /* non-zero if empty entries precede an indexed one */
+};
+
+/*
+ * sg_index_build Build the cumulative-offset index of a list
+ *
+ * @in sg_list   A scatter-gather list
+ *
+ * @ret          The index of the list, NULL on failure
+ *
+ * @note         Empty entries are skipped, as in sg_seek, so an offset is
+ *               found in the same entry sg_seek finds it in.
+ */
+extern sg_index_t *sg_index_build(sg_entry_t *sg_list);
+
+/*
+ * sg_index_destroy Destroy a cumulative-offset index
+ *
+ * @in index     An index made by sg_index_build
+ */
+extern void sg_index_destroy(sg_index_t *index);
+
+/*
+ * sg_index_seek Find the entry holding a given offset using an index
+ *
+ * @in index     Index of a scatter-gather list
+ * @in offset    Offset into the list
+ * @out entry    The entry holding the byte at "offset"
+ * @out intra_offset Offset of that byte inside the entry
+ *
+ * @ret          0 on success, -1 if the list is shorter than "offset"
+ */
+extern int sg_index_seek(const sg_index_t *index, int offset,
+                         sg_entry_t **entry, int *intra_offset);
+
+/*
+ * sg_copy_indexed Copy bytes from an indexed sg list
+ *
+ * @in src       Index of the source sg list
+ * @in dest      Destination sg list
+ * @in src_offset Offset into source
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy, including where the copy stops at an
+ *               empty entry, the source offset is found in O(log n) or
+ *               O(1) instead of walking the source list.
+ */
+extern int sg_copy_indexed(const sg_index_t *src, sg_entry_t *dest,
+                           int src_offset, int count);
+
+/*
+ * sg_offset_search Find the entry holding an offset in a prefix-sum array
+ *
+ * @in offset_array Offset of the first byte of each entry, ascending
+ * @in num_entries Number of entries, at least one
+ * @in offset    An offset, not smaller than offset_array[0]
+ *
+ * @ret          The last entry whose first byte is at or before "offset"
+ */
+extern int sg_offset_search(const int *offset_array, int num_entries, int offset);
+
+#endif /* SG_INDEX_H */
@@ -0,0 +1,125 @@
+#include <limits.h>
+#include "sg_iov.h"
+#include "sg_alloc.h"
+#include "sg_stats.h"
+
+/*
+* sg_to_iovec   Describe a scatter-gather list as an I/O vector
+*
+* @in sg_list   A scatter-gather list
+* @out iov      Elements to fill, may be NULL if max_iov is 0
+* @in max_iov   Number of elements in "iov"
+*
+* @ret          Number of elements the whole list needs, -1 on failure
+*
+* @note         Entries whose buffers are contiguous are merged into one
+*               element. Only the first max_iov elements are written, a
+*               return value larger than max_iov means the vector was
+*               truncated. No data is copied.
+*/
+int sg_to_iovec(sg_entry_t* sg_list, sg_iovec_t* iov, int max_iov)
+{
+  sg_entry_t* list_curr;
+  char* seg_base = NULL;
+  size_t seg_len = 0;
+  int num_iov = 0;
+
+  // check for illegal input parameters
+  if (max_iov < 0) return -1;
+  if (iov == NULL && max_iov > 0) return -1;
+
+  // the list ends at the first entry with a non-positive count, as in sg_copy
+  for (list_curr = sg_list;
+       list_curr != NULL && list_curr->count > 0;
+       list_curr = list_curr->next)
+  {
+    char* entry_base = (char*)phys_to_ptr(list_curr->paddr);
+
+    if (seg_len > 0 && seg_base + seg_len == entry_base)
+    {
+      seg_len += list_curr->count;
+      continue;
+    }
+
+    // close the current element before starting a new one
+    if (seg_len > 0)
+    {
+      if (num_iov < max_iov)
+      {
+        iov[num_iov].iov_base = seg_base;
+        iov[num_iov].iov_len = seg_len;
+      }
+      if (num_iov == INT_MAX) return -1;
+      num_iov++;
+    }
+    seg_base = entry_base;
+    seg_len = list_curr->count;
+  }
+
+  if (seg_len > 0)
+  {
+    if (num_iov < max_iov)
+    {
+      iov[num_iov].iov_base = seg_base;
+      iov[num_iov].iov_len = seg_len;
+    }
+    if (num_iov == INT_MAX) return -1;
+    num_iov++;
+  }
+
+  return num_iov;
+}
+
+/*
+* sg_from_iovec Map the buffers of an I/O vector into one scatter-gather list
+*
+* @in iov       I/O vector
+* @in iovcnt    Number of elements in "iov"
+*
+* @ret          A list of sg_entry elements mapping every buffer in
+*               turn, NULL on failure or if the vector holds no bytes
+*
+* @note         Each buffer is mapped as by sg_map, empty elements are
+*               skipped. The list must be destroyed by sg_destroy.
+*/
+sg_entry_t* sg_from_iovec(const sg_iovec_t* iov, int iovcnt)
+{
+  sg_entry_t* list_head;
+  sg_entry_t* list_curr;
+  size_t num_entries = 0;
+  int i;
+
+  // check for illegal input parameters
+  if (iov == NULL) return NULL;
+  if (iovcnt <= 0) return NULL;
+
+  for (i = 0; i < iovcnt; i++)
+  {
+    int head_count;
+    size_t num_full_pages;
+    int tail_count;
+
+    if (iov[i].iov_len == 0) continue;
+    if (iov[i].iov_base == NULL) return NULL;
+    num_entries += sg_map_layout64(iov[i].iov_base, iov[i].iov_len, &sg_default_geom,
+                                   &head_count, &num_full_pages, &tail_count);
+    // allocators count entries with an int
+    if (num_entries > INT_MAX) return NULL;
+  }
+  if (num_entries == 0) return NULL;
+
+  // reserve the entries of every buffer at once, then fill them in turn
+  list_head = sg_default_allocator.alloc(sg_default_allocator.ctx, (int)num_entries);
+  if (list_head == NULL) return NULL;
+  SG_STAT_ADD(entries_allocated, num_entries);
+
+  list_curr = NULL;
+  for (i = 0; i < iovcnt; i++)
+  {
+    if (iov[i].iov_len == 0) continue;
+    list_curr = sg_map_chain(list_curr == NULL ? list_head : list_curr->next,
+                             iov[i].iov_base, iov[i].iov_len, &sg_default_geom);
+  }
+
+  return list_head;
+}
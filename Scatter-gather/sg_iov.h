@@ -0,0 +1,62 @@
+#ifndef SG_IOV_H
+#define SG_IOV_H
+
+#include <stddef.h>
+#include "sg_copy.h"
+
+/*
+ * I/O vector element
+ *
+ * Note: struct iovec where the platform has one, so arrays can be passed
+ * to readv, writev or io_uring as is. Windows has no vectored file I/O
+ * taking iovecs, an element with the same layout is defined instead
+ */
+#if defined(_WIN32)
+typedef struct sg_iovec_s sg_iovec_t;
+struct sg_iovec_s {
+	void *iov_base;                 /* first byte of the segment */
+	size_t iov_len;                 /* number of bytes in the segment */
+};
+#define SG_IOV_MAX 1024
+#else
+#include <sys/uio.h>
+#include <limits.h>
+typedef struct iovec sg_iovec_t;
+#if defined(IOV_MAX)
+#define SG_IOV_MAX IOV_MAX
+#else
+#define SG_IOV_MAX 1024
+#endif
+#endif
+
+/*
+ * sg_to_iovec   Describe a scatter-gather list as an I/O vector
+ *
+ * @in sg_list   A scatter-gather list
+ * @out iov      Elements to fill, may be NULL if max_iov is 0
+ * @in max_iov   Number of elements in "iov"
+ *
+ * @ret          Number of elements the whole list needs, -1 on failure
+ *
+ * @note         Entries whose buffers are contiguous are merged into one
+ *               element. Only the first max_iov elements are written, a
+ *               return value larger than max_iov means the vector was
+ *               truncated. No data is copied.
+ */
+extern int sg_to_iovec(sg_entry_t *sg_list, sg_iovec_t *iov, int max_iov);
+
+/*
+ * sg_from_iovec Map the buffers of an I/O vector into one scatter-gather list
+ *
+ * @in iov       I/O vector
+ * @in iovcnt    Number of elements in "iov"
+ *
+ * @ret          A list of sg_entry elements mapping every buffer in
+ *               turn, NULL on failure or if the vector holds no bytes
+ *
+ * @note         Each buffer is mapped as by sg_map, empty elements are
+ *               skipped. The list must be destroyed by sg_destroy.
+ */
+extern sg_entry_t *sg_from_iovec(const sg_iovec_t *iov, int iovcnt);
+
+#endif /* SG_IOV_H */
@@ -0,0 +1,433 @@
+#include <stddef.h>
+#include <string.h>
+#include "sg_kernel.h"
+#include "sg_port.h"
+#include "sg_stats.h"
+#include "sg_thread.h"
+
+#if defined(SG_ARCH_X86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(SG_ARCH_NEON)
+#include <arm_neon.h>
+#endif
+
+#define SG_STREAM_MIN 256               // shorter copies are not worth streaming
+#define SG_STREAM_PREFETCH 512          // bytes of source prefetched ahead
+
+static void sg_page_copy_generic(void* dest, const void* src, size_t num_pages)
+{
+  memcpy(dest, src, num_pages * PAGE_SIZE);
+}
+
+#if defined(SG_ARCH_X86) && (PAGE_SIZE % 16 == 0)
+SG_TARGET("sse2")
+static void sg_page_copy_sse2(void* dest, const void* src, size_t num_pages)
+{
+  __m128i* d = (__m128i*)dest;
+  const __m128i* s = (const __m128i*)src;
+  size_t i;
+  int j;
+
+  for (i = 0; i < num_pages; i++)
+  {
+    for (j = 0; j < PAGE_SIZE / 16; j++)
+    {
+      _mm_store_si128(d + j, _mm_load_si128(s + j));
+    }
+    d += PAGE_SIZE / 16;
+    s += PAGE_SIZE / 16;
+  }
+}
+#endif
+
+#if defined(SG_ARCH_X86) && (PAGE_SIZE % 32 == 0)
+SG_TARGET("avx2")
+static void sg_page_copy_avx2(void* dest, const void* src, size_t num_pages)
+{
+  __m256i* d = (__m256i*)dest;
+  const __m256i* s = (const __m256i*)src;
+  size_t i;
+  int j;
+
+  for (i = 0; i < num_pages; i++)
+  {
+    for (j = 0; j < PAGE_SIZE / 32; j++)
+    {
+      _mm256_store_si256(d + j, _mm256_load_si256(s + j));
+    }
+    d += PAGE_SIZE / 32;
+    s += PAGE_SIZE / 32;
+  }
+  // avoid the AVX-SSE transition penalty in the caller
+  _mm256_zeroupper();
+}
+#endif
+
+#if defined(SG_ARCH_X86) && (PAGE_SIZE % 64 == 0)
+SG_TARGET("avx512f")
+static void sg_page_copy_avx512(void* dest, const void* src, size_t num_pages)
+{
+  char* d = (char*)dest;
+  const char* s = (const char*)src;
+  size_t i;
+  int j;
+
+  for (i = 0; i < num_pages; i++)
+  {
+    for (j = 0; j < PAGE_SIZE; j += 64)
+    {
+      _mm512_store_si512(d + j, _mm512_load_si512(s + j));
+    }
+    d += PAGE_SIZE;
+    s += PAGE_SIZE;
+  }
+  _mm256_zeroupper();
+}
+#endif
+
+#if defined(SG_ARCH_NEON) && (PAGE_SIZE % 16 == 0)
+static void sg_page_copy_neon(void* dest, const void* src, size_t num_pages)
+{
+  unsigned char* d = (unsigned char*)dest;
+  const unsigned char* s = (const unsigned char*)src;
+  size_t i;
+  int j;
+
+  for (i = 0; i < num_pages; i++)
+  {
+    for (j = 0; j < PAGE_SIZE; j += 16)
+    {
+      vst1q_u8(d + j, vld1q_u8(s + j));
+    }
+    d += PAGE_SIZE;
+    s += PAGE_SIZE;
+  }
+}
+#endif
+
+#if defined(SG_ARCH_X86)
+/*
+* Streaming copy kernels
+*
+* Note: dest must be aligned on 32 bytes and length a multiple of 64.
+* The stores bypass the cache, the sfence orders them with the stores
+* that follow the copy
+*/
+SG_TARGET("sse2")
+static void sg_stream_copy_sse2(char* d, const char* s, size_t length)
+{
+  __m128i x0;
+  __m128i x1;
+  __m128i x2;
+  __m128i x3;
+  size_t i;
+
+  for (i = 0; i < length; i += 64)
+  {
+    _mm_prefetch(s + i + SG_STREAM_PREFETCH, _MM_HINT_NTA);
+    x0 = _mm_loadu_si128((const __m128i*)(s + i));
+    x1 = _mm_loadu_si128((const __m128i*)(s + i + 16));
+    x2 = _mm_loadu_si128((const __m128i*)(s + i + 32));
+    x3 = _mm_loadu_si128((const __m128i*)(s + i + 48));
+    _mm_stream_si128((__m128i*)(d + i), x0);
+    _mm_stream_si128((__m128i*)(d + i + 16), x1);
+    _mm_stream_si128((__m128i*)(d + i + 32), x2);
+    _mm_stream_si128((__m128i*)(d + i + 48), x3);
+  }
+  _mm_sfence();
+}
+
+SG_TARGET("avx2")
+static void sg_stream_copy_avx2(char* d, const char* s, size_t length)
+{
+  __m256i y0;
+  __m256i y1;
+  size_t i;
+
+  for (i = 0; i < length; i += 64)
+  {
+    _mm_prefetch(s + i + SG_STREAM_PREFETCH, _MM_HINT_NTA);
+    y0 = _mm256_loadu_si256((const __m256i*)(s + i));
+    y1 = _mm256_loadu_si256((const __m256i*)(s + i + 32));
+    _mm256_stream_si256((__m256i*)(d + i), y0);
+    _mm256_stream_si256((__m256i*)(d + i + 32), y1);
+  }
+  _mm_sfence();
+  _mm256_zeroupper();
+}
+#endif
+
+#if defined(SG_ARCH_X86)
+/*
+* sg_cpu_features Query the x86 vector extensions usable on this CPU
+*
+* @out sse2     Non-zero if SSE2 is supported
+* @out avx2     Non-zero if AVX2 is supported by the CPU and the OS
+* @out avx512   Non-zero if AVX-512F is supported by the CPU and the OS
+*/
+static void sg_cpu_features(int* sse2, int* avx2, int* avx512)
+{
+#if defined(_MSC_VER)
+  int info[4];
+  unsigned long long xcr0;
+
+  *sse2 = 0;
+  *avx2 = 0;
+  *avx512 = 0;
+
+  __cpuid(info, 0);
+  if (info[0] < 1) return;
+  __cpuid(info, 1);
+  *sse2 = (info[3] & (1 << 26)) != 0;
+
+  // the OS must save the vector registers on context switches
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return;
+  xcr0 = _xgetbv(0);
+
+  __cpuid(info, 0);
+  if (info[0] < 7) return;
+  __cpuidex(info, 7, 0);
+  *avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+  *avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+#else
+  __builtin_cpu_init();
+  *sse2 = __builtin_cpu_supports("sse2");
+  *avx2 = __builtin_cpu_supports("avx2");
+  *avx512 = __builtin_cpu_supports("avx512f");
+#endif
+}
+#endif
+
+// written once by sg_kernel_select, under sg_kernel_once
+static sg_page_copy_fn sg_page_copy = sg_page_copy_generic;
+static const char* sg_page_copy_name = "generic";
+static sg_once_t sg_kernel_once = SG_ONCE_INIT;
+
+// NULL where non-temporal stores are not available
+static void (*sg_stream_copy)(char* d, const char* s, size_t length);
+
+/*
+* sg_kernel_select Pick the page copy kernel for this CPU
+*
+* @note         Runs once, through sg_kernel_init.
+*/
+static void sg_kernel_select(void)
+{
+  sg_page_copy_fn kernel = sg_page_copy_generic;
+  const char* name = "generic";
+#if defined(SG_ARCH_X86)
+  int sse2;
+  int avx2;
+  int avx512;
+
+  sg_cpu_features(&sse2, &avx2, &avx512);
+  (void)sse2;
+  (void)avx2;
+  (void)avx512;
+  if (sse2) sg_stream_copy = sg_stream_copy_sse2;
+  if (avx2) sg_stream_copy = sg_stream_copy_avx2;
+#if (PAGE_SIZE % 16 == 0)
+  if (sse2)
+  {
+    kernel = sg_page_copy_sse2;
+    name = "sse2";
+  }
+#endif
+#if (PAGE_SIZE % 32 == 0)
+  if (avx2)
+  {
+    kernel = sg_page_copy_avx2;
+    name = "avx2";
+  }
+#endif
+#if (PAGE_SIZE % 64 == 0)
+  if (avx512)
+  {
+    kernel = sg_page_copy_avx512;
+    name = "avx512";
+  }
+#endif
+#elif defined(SG_ARCH_NEON) && (PAGE_SIZE % 16 == 0)
+  kernel = sg_page_copy_neon;
+  name = "neon";
+#endif
+
+  sg_page_copy_name = name;
+  sg_page_copy = kernel;
+}
+
+/*
+* sg_kernel_init Pick the kernels the first time one is needed
+*
+* @note         Threads racing on the first copy wait for the one picking
+*               the kernels, and all of them see the kernels it wrote.
+*/
+static void sg_kernel_init(void)
+{
+  sg_once(&sg_kernel_once, sg_kernel_select);
+}
+
+/*
+* sg_kernel_copy Copy bytes using the page copy kernel where possible
+*
+* @in dest      Destination
+* @in src       Source
+* @in length    Number of bytes to copy
+*
+* @note         Only a single page, aligned on both sides, goes through the
+*               kernel. Anything else, including the long runs sg_run_t
+*               merges across pages, goes through memcpy, which is at
+*               least as fast once the copy is longer than a page.
+*/
+void sg_kernel_copy(void* dest, const void* src, size_t length)
+{
+  if (length == 0) return;
+  SG_STAT_COPY(length);
+
+  if (length != PAGE_SIZE ||
+      ((size_t)dest % PAGE_SIZE) != 0 || ((size_t)src % PAGE_SIZE) != 0)
+  {
+    memcpy(dest, src, length);
+    return;
+  }
+
+  sg_kernel_init();
+  sg_page_copy(dest, src, 1);
+}
+
+/*
+* sg_kernel_copy_nt Copy bytes using non-temporal stores where possible
+*
+* @in dest      Destination
+* @in src       Source
+* @in length    Number of bytes to copy
+*
+* @note         The destination is written around the cache and the source
+*               is prefetched ahead of the copy. Short copies, and CPUs
+*               without streaming stores, fall back to sg_kernel_copy.
+*/
+void sg_kernel_copy_nt(void* dest, const void* src, size_t length)
+{
+  char* d = (char*)dest;
+  const char* s = (const char*)src;
+  size_t head_count;
+  size_t body_count;
+
+  if (length < SG_STREAM_MIN)
+  {
+    sg_kernel_copy(dest, src, length);
+    return;
+  }
+  sg_kernel_init();
+  if (sg_stream_copy == NULL)
+  {
+    sg_kernel_copy(dest, src, length);
+    return;
+  }
+  SG_STAT_COPY(length);
+
+  // the streaming stores need an aligned destination
+  head_count = (32 - (size_t)d % 32) % 32;
+  memcpy(d, s, head_count);
+  d += head_count;
+  s += head_count;
+  length -= head_count;
+
+  body_count = length & ~(size_t)63;
+  sg_stream_copy(d, s, body_count);
+  d += body_count;
+  s += body_count;
+  length -= body_count;
+
+  memcpy(d, s, length);
+}
+
+/*
+* sg_kernel_force Use a given page copy kernel instead of the one picked
+*
+* @in name      "avx512", "avx2", "sse2", "neon" or "generic"
+*
+* @ret          0 on success, -1 if the kernel is unknown or the CPU (or
+*               PAGE_SIZE) does not support it
+*
+* @note         Meant for benchmarks comparing kernels, to be called
+*               before copies run. The non-temporal kernels are not
+*               affected.
+*/
+int sg_kernel_force(const char* name)
+{
+  sg_page_copy_fn kernel = NULL;
+  const char* kernel_name = NULL;
+#if defined(SG_ARCH_X86)
+  int sse2;
+  int avx2;
+  int avx512;
+#endif
+
+  if (name == NULL) return -1;
+
+  // the streaming kernel is still picked from the CPU
+  sg_kernel_init();
+
+  if (strcmp(name, "generic") == 0)
+  {
+    kernel = sg_page_copy_generic;
+    kernel_name = "generic";
+  }
+#if defined(SG_ARCH_X86)
+  sg_cpu_features(&sse2, &avx2, &avx512);
+  (void)sse2;
+  (void)avx2;
+  (void)avx512;
+#if (PAGE_SIZE % 16 == 0)
+  if (sse2 && strcmp(name, "sse2") == 0)
+  {
+    kernel = sg_page_copy_sse2;
+    kernel_name = "sse2";
+  }
+#endif
+#if (PAGE_SIZE % 32 == 0)
+  if (avx2 && strcmp(name, "avx2") == 0)
+  {
+    kernel = sg_page_copy_avx2;
+    kernel_name = "avx2";
+  }
+#endif
+#if (PAGE_SIZE % 64 == 0)
+  if (avx512 && strcmp(name, "avx512") == 0)
+  {
+    kernel = sg_page_copy_avx512;
+    kernel_name = "avx512";
+  }
+#endif
+#elif defined(SG_ARCH_NEON) && (PAGE_SIZE % 16 == 0)
+  if (strcmp(name, "neon") == 0)
+  {
+    kernel = sg_page_copy_neon;
+    kernel_name = "neon";
+  }
+#endif
+  if (kernel == NULL) return -1;
+
+  sg_page_copy_name = kernel_name;
+  sg_page_copy = kernel;
+
+  return 0;
+}
+
+/*
+* sg_kernel_name Name of the selected page copy kernel
+*
+* @ret          "avx512", "avx2", "sse2", "neon" or "generic"
+*/
+const char* sg_kernel_name(void)
+{
+  sg_kernel_init();
+
+  return sg_page_copy_name;
+}
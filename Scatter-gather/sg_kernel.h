@@ -0,0 +1,63 @@
+#ifndef SG_KERNEL_H
+#define SG_KERNEL_H
+
+#include <stddef.h>
+#include "sg_copy.h"
+
+/*
+ * Page copy kernel
+ *
+ * Note: copies num_pages * PAGE_SIZE bytes, dest and src must both be
+ * aligned on a PAGE_SIZE address. The kernel used is picked once, the
+ * first time one is needed, from the instruction sets the CPU supports
+ */
+typedef void (*sg_page_copy_fn)(void *dest, const void *src, size_t num_pages);
+
+/*
+ * sg_kernel_copy Copy bytes using the page copy kernel where possible
+ *
+ * @in dest      Destination
+ * @in src       Source
+ * @in length    Number of bytes to copy
+ *
+ * @note         Only a copy of exactly one page, aligned on both sides,
+ *               goes through the kernel. Anything else, including the
+ *               long runs merged by sg_run_t, goes through memcpy.
+ */
+extern void sg_kernel_copy(void *dest, const void *src, size_t length);
+
+/*
+ * sg_kernel_copy_nt Copy bytes using non-temporal stores where possible
+ *
+ * @in dest      Destination
+ * @in src       Source
+ * @in length    Number of bytes to copy
+ *
+ * @note         The destination is written around the cache and the source
+ *               is prefetched ahead of the copy. Short copies, and CPUs
+ *               without streaming stores, fall back to sg_kernel_copy.
+ */
+extern void sg_kernel_copy_nt(void *dest, const void *src, size_t length);
+
+/*
+ * sg_kernel_force Use a given page copy kernel instead of the one picked
+ *
+ * @in name      "avx512", "avx2", "sse2", "neon" or "generic"
+ *
+ * @ret          0 on success, -1 if the kernel is unknown or the CPU (or
+ *               PAGE_SIZE) does not support it
+ *
+ * @note         Meant for benchmarks comparing kernels, to be called
+ *               before copies run. The non-temporal kernels are not
+ *               affected.
+ */
+extern int sg_kernel_force(const char *name);
+
+/*
+ * sg_kernel_name Name of the selected page copy kernel
+ *
+ * @ret          "avx512", "avx2", "sse2", "neon" or "generic"
+ */
+extern const char *sg_kernel_name(void);
+
+#endif /* SG_KERNEL_H */
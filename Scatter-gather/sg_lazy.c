@@ -0,0 +1,176 @@
+#include "sg_lazy.h"
+
+/*
+* sg_lazy_map   Map a memory buffer lazily
+*
+* @out lazy     Lazy mapping to initialize
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+* @in geom      Mapping geometry, NULL for sg_default_geom
+*
+* @ret          0 on success, -1 on failure
+*
+* @note         O(1), nothing is allocated. Nothing needs to be released.
+*/
+int sg_lazy_map(sg_lazy_t* lazy, void* buf, size_t length, const sg_geom_t* geom)
+{
+  size_t num_full_pages;
+  int tail_count;
+
+  // check for illegal input parameters
+  if (lazy == NULL) return -1;
+  if (buf == NULL) return -1;
+  if (length == 0) return -1;
+  if (geom == NULL) geom = &sg_default_geom;
+
+  lazy->base = (char*)buf;
+  lazy->length = length;
+  lazy->geom = *geom;
+  lazy->num_entries = sg_map_layout64(buf, length, geom, &lazy->head_count,
+                                      &num_full_pages, &tail_count);
+
+  return 0;
+}
+
+/*
+* sg_lazy_entry Generate one entry of a lazy mapping
+*
+* @in lazy      A lazy mapping
+* @in index     Position of the entry, the first one being 0
+* @out entry    The entry, its next entry is NULL
+*
+* @ret          0 on success, -1 if the mapping has fewer entries
+*/
+int sg_lazy_entry(const sg_lazy_t* lazy, size_t index, sg_entry_t* entry)
+{
+  size_t start;
+  size_t count;
+
+  if (lazy == NULL || entry == NULL) return -1;
+  if (index >= lazy->num_entries) return -1;
+
+  if (index == 0)
+  {
+    init_entry(entry, ptr_to_phys(lazy->base), lazy->head_count, NULL);
+    return 0;
+  }
+
+  // every entry after the first one starts on a page boundary
+  start = (size_t)lazy->head_count + (index - 1) * (size_t)lazy->geom.page_size;
+  count = lazy->length - start;
+  if (count > (size_t)lazy->geom.page_size) count = (size_t)lazy->geom.page_size;
+  init_entry(entry, ptr_to_phys(lazy->base + start), (int)count, NULL);
+
+  return 0;
+}
+
+/*
+* sg_lazy_seek  Generate the entry holding a given offset
+*
+* @in lazy      A lazy mapping
+* @in offset    Offset into the buffer
+* @out entry    The entry holding the byte at "offset", its next entry
+*               is NULL
+* @out index    Position of that entry, may be NULL
+* @out intra_offset Offset of that byte inside the entry
+*
+* @ret          0 on success, -1 if the buffer is shorter than "offset"
+*
+* @note         O(1), where sg_seek walks the list.
+*/
+int sg_lazy_seek(const sg_lazy_t* lazy, size_t offset, sg_entry_t* entry,
+                 size_t* index, int* intra_offset)
+{
+  size_t entry_index;
+  size_t page_offset;
+
+  if (lazy == NULL || entry == NULL || intra_offset == NULL) return -1;
+  if (offset >= lazy->length) return -1;
+
+  if (offset < (size_t)lazy->head_count)
+  {
+    entry_index = 0;
+    *intra_offset = (int)offset;
+  }
+  else
+  {
+    page_offset = offset - lazy->head_count;
+    if (lazy->geom.page_shift >= 0)
+    {
+      entry_index = 1 + (page_offset >> lazy->geom.page_shift);
+      *intra_offset = (int)(page_offset & ((size_t)lazy->geom.page_size - 1));
+    }
+    else
+    {
+      entry_index = 1 + page_offset / lazy->geom.page_size;
+      *intra_offset = (int)(page_offset % lazy->geom.page_size);
+    }
+  }
+  if (index != NULL) *index = entry_index;
+
+  return sg_lazy_entry(lazy, entry_index, entry);
+}
+
+/*
+* sg_lazy_expand Build the linked list of a lazy mapping
+*
+* @in lazy      A lazy mapping
+* @in allocator Entry allocator, NULL for sg_default_allocator
+*
+* @ret          The list sg_map_geom64 would return, NULL on failure
+*
+* @note         For APIs that need linked entries. The list must be
+*               destroyed by sg_destroy_with.
+*/
+sg_entry_t* sg_lazy_expand(const sg_lazy_t* lazy, const sg_allocator_t* allocator)
+{
+  if (lazy == NULL) return NULL;
+
+  return sg_map_geom64(lazy->base, lazy->length, &lazy->geom, allocator);
+}
+
+/*
+* sg_copy_lazy  Copy bytes from a lazy mapping into a scatter-gather list
+*
+* @in src       Source lazy mapping
+* @in src_offset Offset into source
+* @in dest      Destination sg list
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy64 from the mapped list. No entry is
+*               generated for the source, its bytes are contiguous.
+*/
+size_t sg_copy_lazy(const sg_lazy_t* src, size_t src_offset,
+                    sg_entry_t* dest, size_t count)
+{
+  // no bytes are copied if one of the parameters is illogical
+  if (src == NULL) return 0;
+  if (src_offset >= src->length) return 0;
+  if (count > src->length - src_offset) count = src->length - src_offset;
+
+  return sg_scatter(src->base + src_offset, count, dest, 0);
+}
+
+/*
+* sg_copy_into_lazy Copy bytes from a scatter-gather list into a lazy mapping
+*
+* @in src       Source sg list
+* @in src_offset Offset into source
+* @in dest      Destination lazy mapping
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy64 into the mapped list, as by sg_gather.
+*/
+size_t sg_copy_into_lazy(sg_entry_t* src, size_t src_offset,
+                         const sg_lazy_t* dest, size_t count)
+{
+  // no bytes are copied if one of the parameters is illogical
+  if (dest == NULL) return 0;
+  if (count > dest->length) count = dest->length;
+
+  return sg_gather(src, src_offset, dest->base, count);
+}
@@ -0,0 +1,114 @@
+#ifndef SG_LAZY_H
+#define SG_LAZY_H
+
+#include <stddef.h>
+#include "sg_copy.h"
+#include "sg_alloc.h"
+
+/*
+ * Lazily mapped buffer
+ *
+ * Note: holds only what sg_map_geom64 would compute the entries from.
+ * Entry 0 maps head_count bytes from base, entry i > 0 maps up to
+ * geom.page_size bytes from base + head_count + (i - 1) * page_size,
+ * exactly as in the mapped list. Entries are generated when needed, so
+ * mapping takes O(1) time and memory whatever the buffer size
+ */
+typedef struct sg_lazy_s sg_lazy_t;
+struct sg_lazy_s {
+	char *base;                     /* first byte of the buffer */
+	size_t length;                  /* buffer length in bytes */
+	sg_geom_t geom;                 /* mapping geometry */
+	int head_count;                 /* number of bytes in entry 0 */
+	size_t num_entries;             /* number of entries of the mapping */
+};
+
+/*
+ * sg_lazy_map   Map a memory buffer lazily
+ *
+ * @out lazy     Lazy mapping to initialize
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ *
+ * @ret          0 on success, -1 on failure
+ *
+ * @note         O(1), nothing is allocated. Nothing needs to be released.
+ */
+extern int sg_lazy_map(sg_lazy_t *lazy, void *buf, size_t length,
+                       const sg_geom_t *geom);
+
+/*
+ * sg_lazy_entry Generate one entry of a lazy mapping
+ *
+ * @in lazy      A lazy mapping
+ * @in index     Position of the entry, the first one being 0
+ * @out entry    The entry, its next entry is NULL
+ *
+ * @ret          0 on success, -1 if the mapping has fewer entries
+ */
+extern int sg_lazy_entry(const sg_lazy_t *lazy, size_t index, sg_entry_t *entry);
+
+/*
+ * sg_lazy_seek  Generate the entry holding a given offset
+ *
+ * @in lazy      A lazy mapping
+ * @in offset    Offset into the buffer
+ * @out entry    The entry holding the byte at "offset", its next entry
+ *               is NULL
+ * @out index    Position of that entry, may be NULL
+ * @out intra_offset Offset of that byte inside the entry
+ *
+ * @ret          0 on success, -1 if the buffer is shorter than "offset"
+ *
+ * @note         O(1), where sg_seek walks the list.
+ */
+extern int sg_lazy_seek(const sg_lazy_t *lazy, size_t offset, sg_entry_t *entry,
+                        size_t *index, int *intra_offset);
+
+/*
+ * sg_lazy_expand Build the linked list of a lazy mapping
+ *
+ * @in lazy      A lazy mapping
+ * @in allocator Entry allocator, NULL for sg_default_allocator
+ *
+ * @ret          The list sg_map_geom64 would return, NULL on failure
+ *
+ * @note         For APIs that need linked entries. The list must be
+ *               destroyed by sg_destroy_with.
+ */
+extern sg_entry_t *sg_lazy_expand(const sg_lazy_t *lazy,
+                                  const sg_allocator_t *allocator);
+
+/*
+ * sg_copy_lazy  Copy bytes from a lazy mapping into a scatter-gather list
+ *
+ * @in src       Source lazy mapping
+ * @in src_offset Offset into source
+ * @in dest      Destination sg list
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy64 from the mapped list. No entry is
+ *               generated for the source, its bytes are contiguous.
+ */
+extern size_t sg_copy_lazy(const sg_lazy_t *src, size_t src_offset,
+                           sg_entry_t *dest, size_t count);
+
+/*
+ * sg_copy_into_lazy Copy bytes from a scatter-gather list into a lazy mapping
+ *
+ * @in src       Source sg list
+ * @in src_offset Offset into source
+ * @in dest      Destination lazy mapping
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy64 into the mapped list, as by sg_gather.
+ */
+extern size_t sg_copy_into_lazy(sg_entry_t *src, size_t src_offset,
+                                const sg_lazy_t *dest, size_t count);
+
+#endif /* SG_LAZY_H */
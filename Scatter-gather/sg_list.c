@@ -0,0 +1,357 @@
+#include <limits.h>
+#include <string.h>
+#include "sg_list.h"
+#include "sg_stats.h"
+
+/*
+* sg_list_find  Find the entry holding an offset into a list
+*
+* @in list      A list
+* @in offset    Offset into the list, smaller than its length
+* @out prev     The entry before the one found, NULL if it is the head
+* @out intra_offset Offset of that byte inside the entry found
+* @out index    Position of the entry found, the head being 0
+*
+* @ret          The entry holding the byte at "offset"
+*/
+static sg_entry_t* sg_list_find(const sg_list_t* list, size_t offset,
+                                sg_entry_t** prev, int* intra_offset, int* index)
+{
+  sg_entry_t* list_curr = list->head;
+  size_t position = offset + list->head_offset;
+
+  *prev = NULL;
+  *index = 0;
+  while ((size_t)list_curr->count <= position)
+  {
+    position -= list_curr->count;
+    *prev = list_curr;
+    list_curr = list_curr->next;
+    (*index)++;
+  }
+  *intra_offset = (int)position;
+
+  return list_curr;
+}
+
+/*
+* sg_list_init  Take ownership of an existing scatter-gather list
+*
+* @out list     Header to initialize
+* @in sg_list   A scatter-gather list, may be NULL for an empty list
+* @in allocator The allocator the list was built with, NULL for
+*               sg_default_allocator
+*
+* @ret          0 on success, -1 on failure
+*
+* @note         The list is walked once. It ends at the first entry with
+*               a non-positive count, as in sg_copy, and is cut there.
+*               Entries after that point are not part of the list.
+*/
+int sg_list_init(sg_list_t* list, sg_entry_t* sg_list, const sg_allocator_t* allocator)
+{
+  sg_entry_t* list_curr;
+
+  if (list == NULL) return -1;
+  if (allocator == NULL) allocator = &sg_default_allocator;
+
+  memset(list, 0, sizeof(sg_list_t));
+  list->allocator = allocator;
+
+  for (list_curr = sg_list;
+       list_curr != NULL && list_curr->count > 0;
+       list_curr = list_curr->next)
+  {
+    if (list->num_entries == INT_MAX) return -1;
+    if (list->head == NULL) list->head = list_curr;
+    list->tail = list_curr;
+    list->num_entries++;
+    list->length += list_curr->count;
+  }
+  if (list->tail != NULL) list->tail->next = NULL;
+
+  return 0;
+}
+
+/*
+* sg_list_map   Map a memory buffer into a list header
+*
+* @out list     Header to initialize
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+* @in geom      Mapping geometry, NULL for sg_default_geom
+* @in allocator Entry allocator, NULL for sg_default_allocator
+*
+* @ret          0 on success, -1 on failure
+*
+* @note         Same entries as sg_map_geom64, the tail is known without
+*               walking the list.
+*/
+int sg_list_map(sg_list_t* list, void* buf, size_t length,
+                const sg_geom_t* geom, const sg_allocator_t* allocator)
+{
+  int head_count;
+  size_t num_full_pages;
+  int tail_count;
+  size_t num_entries;
+
+  // check for illegal input parameters
+  if (list == NULL) return -1;
+  if (buf == NULL) return -1;
+  if (length == 0) return -1;
+  if (geom == NULL) geom = &sg_default_geom;
+  if (allocator == NULL) allocator = &sg_default_allocator;
+
+  num_entries = sg_map_layout64(buf, length, geom,
+                                &head_count, &num_full_pages, &tail_count);
+  // allocators count entries with an int
+  if (num_entries > INT_MAX) return -1;
+
+  list->head = allocator->alloc(allocator->ctx, (int)num_entries);
+  if (list->head == NULL) return -1;
+  SG_STAT_ADD(entries_allocated, num_entries);
+
+  list->tail = sg_map_chain(list->head, buf, length, geom);
+  list->head_offset = 0;
+  list->num_entries = (int)num_entries;
+  list->length = length;
+  list->allocator = allocator;
+
+  return 0;
+}
+
+/*
+* sg_list_destroy Release the entries of a list
+*
+* @in list      A list header, left empty
+*
+* @note         An owning list goes back to its allocator with a single
+*               call and no traversal. Only its head is marked
+*               SG_ENTRY_FREED, so sg_destroy and sg_normalize stop at a
+*               list spliced onto it. Its other entries must not be
+*               reached through "next" once it is destroyed. Views own
+*               nothing, they are only emptied.
+*/
+void sg_list_destroy(sg_list_t* list)
+{
+  const sg_allocator_t* allocator;
+
+  if (list == NULL) return;
+
+  allocator = list->allocator;
+  if (allocator != NULL && list->head != NULL)
+  {
+    // entries are reached from other lists through their head only
+    list->head->count = SG_ENTRY_FREED;
+    allocator->release(allocator->ctx, list->head, list->tail, list->num_entries);
+    SG_STAT_ADD(entries_freed, list->num_entries);
+  }
+
+  memset(list, 0, sizeof(sg_list_t));
+  list->allocator = allocator;
+}
+
+/*
+* sg_concat     Append a list to another one
+*
+* @in list      Owning list to append to
+* @in other     Owning list to append, left empty
+*
+* @ret          0 on success, -1 if either list is a view or the lists
+*               have different allocators
+*
+* @note         O(1).
+*/
+int sg_concat(sg_list_t* list, sg_list_t* other)
+{
+  if (list == NULL || other == NULL || list == other) return -1;
+  if (list->allocator == NULL || list->allocator != other->allocator) return -1;
+  if (other->num_entries > INT_MAX - list->num_entries) return -1;
+
+  if (other->head == NULL) return 0;
+
+  if (list->head == NULL)
+    list->head = other->head;
+  else
+    list->tail->next = other->head;
+  list->tail = other->tail;
+  list->num_entries += other->num_entries;
+  list->length += other->length;
+
+  other->head = NULL;
+  other->tail = NULL;
+  other->num_entries = 0;
+  other->length = 0;
+
+  return 0;
+}
+
+/*
+* sg_slice      Make a view of a range of a list
+*
+* @in list      A list
+* @in offset    Offset of the range into the list
+* @in length    Number of bytes in the range
+* @out slice    View of the range, sharing the entries of "list"
+*
+* @ret          0 on success, -1 if the range is not inside the list
+*
+* @note         Nothing is allocated. The view is valid as long as the
+*               entries of "list" are.
+*/
+int sg_slice(const sg_list_t* list, size_t offset, size_t length, sg_list_t* slice)
+{
+  sg_entry_t* prev;
+  int first_index;
+  int last_index;
+  size_t position;
+
+  if (list == NULL || slice == NULL) return -1;
+  if (offset > list->length || length > list->length - offset) return -1;
+
+  if (length == 0)
+  {
+    memset(slice, 0, sizeof(sg_list_t));
+    return 0;
+  }
+
+  slice->head = sg_list_find(list, offset, &prev, &slice->head_offset, &first_index);
+
+  // the last byte is searched from the head of the slice
+  slice->tail = slice->head;
+  last_index = first_index;
+  position = length - 1 + slice->head_offset;
+  while ((size_t)slice->tail->count <= position)
+  {
+    position -= slice->tail->count;
+    slice->tail = slice->tail->next;
+    last_index++;
+  }
+  slice->num_entries = last_index - first_index + 1;
+  slice->length = length;
+  slice->allocator = NULL;
+
+  return 0;
+}
+
+/*
+* sg_split_at   Split a list in two at a given offset
+*
+* @in list      A list, keeps the bytes before "offset"
+* @out rest     Gets the bytes from "offset" on
+* @in offset    Offset into the list
+*
+* @ret          0 on success, -1 on failure
+*
+* @note         The entry holding "offset" is found by walking the list
+*               from its head, no data is copied. Splitting an owning
+*               list in the middle of an entry takes one new entry from
+*               the allocator, splitting a view never allocates.
+*/
+int sg_split_at(sg_list_t* list, size_t offset, sg_list_t* rest)
+{
+  const sg_allocator_t* allocator;
+  sg_entry_t* prev;
+  sg_entry_t* entry;
+  sg_entry_t* second;
+  int intra_offset;
+  int index;
+
+  if (list == NULL || rest == NULL || list == rest) return -1;
+  if (offset > list->length) return -1;
+
+  allocator = list->allocator;
+
+  // views are split into two views of the same entries
+  if (allocator == NULL)
+  {
+    sg_list_t view = *list;
+
+    if (sg_slice(&view, offset, view.length - offset, rest) != 0) return -1;
+    return sg_slice(&view, 0, offset, list);
+  }
+
+  memset(rest, 0, sizeof(sg_list_t));
+  rest->allocator = allocator;
+  if (offset == list->length) return 0;
+  if (offset == 0)
+  {
+    *rest = *list;
+    list->head = NULL;
+    list->tail = NULL;
+    list->num_entries = 0;
+    list->length = 0;
+    return 0;
+  }
+
+  entry = sg_list_find(list, offset, &prev, &intra_offset, &index);
+
+  if (intra_offset == 0)
+  {
+    // cut between two entries
+    prev->next = NULL;
+    rest->head = entry;
+    rest->tail = list->tail;
+    rest->num_entries = list->num_entries - index;
+    list->tail = prev;
+    list->num_entries = index;
+  }
+  else
+  {
+    // the entry keeps its first bytes, a new one maps the others
+    second = allocator->alloc(allocator->ctx, 1);
+    if (second == NULL) return -1;
+    SG_STAT_ADD(entries_allocated, 1);
+
+    init_entry(second,
+               ptr_to_phys((char*)phys_to_ptr(entry->paddr) + intra_offset),
+               entry->count - intra_offset, entry->next);
+    entry->count = intra_offset;
+    entry->next = NULL;
+    rest->head = second;
+    rest->tail = list->tail == entry ? second : list->tail;
+    rest->num_entries = list->num_entries - index;
+    list->tail = entry;
+    list->num_entries = index + 1;
+  }
+  rest->length = list->length - offset;
+  list->length = offset;
+
+  return 0;
+}
+
+/*
+* sg_list_copy  Copy bytes between two lists
+*
+* @in src       Source list
+* @in src_offset Offset into source
+* @in dest      Destination list
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same as sg_copy64, bounded by the lengths of both lists
+*               so views copy only their own range.
+*/
+size_t sg_list_copy(const sg_list_t* src, size_t src_offset,
+                    const sg_list_t* dest, size_t count)
+{
+  sg_cursor_t src_cursor;
+  sg_cursor_t dest_cursor;
+  sg_entry_t* prev;
+  int index;
+
+  // no bytes are copied if one of the parameters is illogical
+  if (src == NULL || dest == NULL) return 0;
+  if (src_offset >= src->length) return 0;
+  if (dest->length == 0) return 0;
+  if (count > src->length - src_offset) count = src->length - src_offset;
+  if (count > dest->length) count = dest->length;
+  if (count == 0) return 0;
+
+  src_cursor.entry = sg_list_find(src, src_offset, &prev, &src_cursor.offset, &index);
+  dest_cursor.entry = dest->head;
+  dest_cursor.offset = dest->head_offset;
+
+  return sg_copy_from_cursor64(&src_cursor, &dest_cursor, count);
+}
@@ -0,0 +1,138 @@
+#ifndef SG_LIST_H
+#define SG_LIST_H
+
+#include <stddef.h>
+#include "sg_copy.h"
+#include "sg_alloc.h"
+
+/*
+ * Scatter-gather list header
+ *
+ * Note: a list whose first and last entries, entry count and length
+ * are known, so appending and releasing it need no traversal. The list
+ * covers "length" bytes starting "head_offset" bytes into "head", and
+ * ends inside "tail". An owning list (allocator not NULL) starts at the
+ * first byte of head, ends at the last byte of tail and tail->next is
+ * NULL. A view (allocator NULL) shares the entries of another list and
+ * must not outlive it. An empty list has a NULL head
+ */
+typedef struct sg_list_s sg_list_t;
+struct sg_list_s {
+	sg_entry_t *head;               /* first entry */
+	sg_entry_t *tail;               /* last entry */
+	int head_offset;                /* bytes of head before the list starts */
+	int num_entries;                /* number of entries from head to tail */
+	size_t length;                  /* number of bytes in the list */
+	const sg_allocator_t *allocator; /* allocator owning the entries, NULL for views */
+};
+
+/*
+ * sg_list_init  Take ownership of an existing scatter-gather list
+ *
+ * @out list     Header to initialize
+ * @in sg_list   A scatter-gather list, may be NULL for an empty list
+ * @in allocator The allocator the list was built with, NULL for
+ *               sg_default_allocator
+ *
+ * @ret          0 on success, -1 on failure
+ *
+ * @note         The list is walked once. It ends at the first entry with
+ *               a non-positive count, as in sg_copy, and is cut there.
+ *               Entries after that point are not part of the list.
+ */
+extern int sg_list_init(sg_list_t *list, sg_entry_t *sg_list,
+                        const sg_allocator_t *allocator);
+
+/*
+ * sg_list_map   Map a memory buffer into a list header
+ *
+ * @out list     Header to initialize
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ * @in allocator Entry allocator, NULL for sg_default_allocator
+ *
+ * @ret          0 on success, -1 on failure
+ *
+ * @note         Same entries as sg_map_geom64, the tail is known without
+ *               walking the list.
+ */
+extern int sg_list_map(sg_list_t *list, void *buf, size_t length,
+                       const sg_geom_t *geom, const sg_allocator_t *allocator);
+
+/*
+ * sg_list_destroy Release the entries of a list
+ *
+ * @in list      A list header, left empty
+ *
+ * @note         An owning list goes back to its allocator with a single
+ *               call and no traversal. Only its head is marked
+ *               SG_ENTRY_FREED, so sg_destroy and sg_normalize stop at a
+ *               list spliced onto it. Its other entries must not be
+ *               reached through "next" once it is destroyed. Views own
+ *               nothing, they are only emptied.
+ */
+extern void sg_list_destroy(sg_list_t *list);
+
+/*
+ * sg_concat     Append a list to another one
+ *
+ * @in list      Owning list to append to
+ * @in other     Owning list to append, left empty
+ *
+ * @ret          0 on success, -1 if either list is a view or the lists
+ *               have different allocators
+ *
+ * @note         O(1).
+ */
+extern int sg_concat(sg_list_t *list, sg_list_t *other);
+
+/*
+ * sg_split_at   Split a list in two at a given offset
+ *
+ * @in list      A list, keeps the bytes before "offset"
+ * @out rest     Gets the bytes from "offset" on
+ * @in offset    Offset into the list
+ *
+ * @ret          0 on success, -1 on failure
+ *
+ * @note         The entry holding "offset" is found by walking the list
+ *               from its head, no data is copied. Splitting an owning
+ *               list in the middle of an entry takes one new entry from
+ *               the allocator, splitting a view never allocates.
+ */
+extern int sg_split_at(sg_list_t *list, size_t offset, sg_list_t *rest);
+
+/*
+ * sg_slice      Make a view of a range of a list
+ *
+ * @in list      A list
+ * @in offset    Offset of the range into the list
+ * @in length    Number of bytes in the range
+ * @out slice    View of the range, sharing the entries of "list"
+ *
+ * @ret          0 on success, -1 if the range is not inside the list
+ *
+ * @note         Nothing is allocated. The view is valid as long as the
+ *               entries of "list" are.
+ */
+extern int sg_slice(const sg_list_t *list, size_t offset, size_t length,
+                    sg_list_t *slice);
+
+/*
+ * sg_list_copy  Copy bytes between two lists
+ *
+ * @in src       Source list
+ * @in src_offset Offset into source
+ * @in dest      Destination list
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same as sg_copy64, bounded by the lengths of both lists
+ *               so views copy only their own range.
+ */
+extern size_t sg_list_copy(const sg_list_t *src, size_t src_offset,
+                           const sg_list_t *dest, size_t count);
+
+#endif /* SG_LIST_H */
@@ -0,0 +1,351 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sg_move.h"
+#include "sg_kernel.h"
+#include "sg_stats.h"
+
+/*
+* Segment of a move
+*
+* Note: the bytes of one source entry and one destination entry that
+* are copied together, as in sg_copy. Segments are numbered in copy
+* order, "overlap" is set when a segment's source and destination share
+* bytes
+*/
+typedef struct sg_move_seg_s {
+  char* dest;
+  const char* src;
+  size_t length;
+  int overlap;
+} sg_move_seg_t;
+
+/*
+* sg_move_walk  Split a move into segments
+*
+* @in src       Source cursor, at the first byte to copy
+* @in dest      Destination sg list
+* @in count     Number of bytes to copy
+* @out segs     Segments of the move, NULL to only count them
+* @out src_lo   Lowest source address, may be NULL
+* @out src_hi   One past the highest source address, may be NULL
+* @out dest_lo  Lowest destination address, may be NULL
+* @out dest_hi  One past the highest destination address, may be NULL
+*
+* @ret          Number of segments
+*/
+static size_t sg_move_walk(sg_cursor_t src, sg_entry_t* dest, size_t count,
+                           sg_move_seg_t* segs, char** src_lo, char** src_hi,
+                           char** dest_lo, char** dest_hi)
+{
+  sg_entry_t* src_curr = src.entry;
+  sg_entry_t* dest_curr = dest;
+  int offset_in_src_entry = src.offset;
+  int offset_in_dest_entry = 0;
+  size_t remaining_bytes_to_copy = count;
+  size_t num_segs = 0;
+
+  while (remaining_bytes_to_copy > 0 && dest_curr != NULL && src_curr != NULL)
+  {
+    char* p_src;
+    char* p_dest;
+    int remaining_bytes_in_src_entry;
+    int remaining_bytes_in_dest_entry;
+    int bytes_to_copy;
+
+    if (src_curr->count <= 0) break;
+    if (dest_curr->count <= 0) break;
+
+    p_src = (char*)phys_to_ptr(src_curr->paddr) + offset_in_src_entry;
+    p_dest = (char*)phys_to_ptr(dest_curr->paddr) + offset_in_dest_entry;
+
+    // copy up to the end of whichever entry ends first
+    remaining_bytes_in_src_entry = src_curr->count - offset_in_src_entry;
+    remaining_bytes_in_dest_entry = dest_curr->count - offset_in_dest_entry;
+    bytes_to_copy = remaining_bytes_in_src_entry < remaining_bytes_in_dest_entry ?
+                    remaining_bytes_in_src_entry : remaining_bytes_in_dest_entry;
+    if ((size_t)bytes_to_copy > remaining_bytes_to_copy)
+      bytes_to_copy = (int)remaining_bytes_to_copy;
+
+    if (segs != NULL)
+    {
+      segs[num_segs].dest = p_dest;
+      segs[num_segs].src = p_src;
+      segs[num_segs].length = bytes_to_copy;
+      segs[num_segs].overlap = 0;
+    }
+    if (src_lo != NULL)
+    {
+      if (num_segs == 0 || p_src < *src_lo) *src_lo = p_src;
+      if (num_segs == 0 || p_src + bytes_to_copy > *src_hi) *src_hi = p_src + bytes_to_copy;
+      if (num_segs == 0 || p_dest < *dest_lo) *dest_lo = p_dest;
+      if (num_segs == 0 || p_dest + bytes_to_copy > *dest_hi) *dest_hi = p_dest + bytes_to_copy;
+    }
+    num_segs++;
+    remaining_bytes_to_copy -= bytes_to_copy;
+
+    // move to the next entry on the sides that were used up
+    offset_in_src_entry += bytes_to_copy;
+    if (offset_in_src_entry == src_curr->count)
+    {
+      src_curr = src_curr->next;
+      offset_in_src_entry = 0;
+    }
+    offset_in_dest_entry += bytes_to_copy;
+    if (offset_in_dest_entry == dest_curr->count)
+    {
+      dest_curr = dest_curr->next;
+      offset_in_dest_entry = 0;
+    }
+  }
+
+  return num_segs;
+}
+
+/*
+* Source range of a segment
+*
+* Note: sg_move_hazards sorts these by address, "index" is the position
+* of their segment in copy order
+*/
+typedef struct sg_move_span_s {
+  const char* src;
+  size_t length;
+  size_t index;
+} sg_move_span_t;
+
+static int sg_move_compare(const void* a, const void* b)
+{
+  const char* src_a = ((const sg_move_span_t*)a)->src;
+  const char* src_b = ((const sg_move_span_t*)b)->src;
+
+  return src_a < src_b ? -1 : (src_a > src_b ? 1 : 0);
+}
+
+/*
+* sg_move_hazards Find which copy orders a move allows
+*
+* @in segs      Segments of the move, their overlap flags are set
+* @in num_segs  Number of segments
+* @out forward  Non-zero if copying the segments in order is safe
+* @out backward Non-zero if copying them in reverse order is safe
+*
+* @ret          0 on success, -1 on failure
+*
+* @note         A segment may not overwrite the source of a segment
+*               copied after it. Sources are sorted by address, so the
+*               sources overlapping each destination are found by a
+*               binary search, in O(n log n) overall.
+*/
+static int sg_move_hazards(sg_move_seg_t* segs, size_t num_segs,
+                           int* forward, int* backward)
+{
+  sg_move_span_t* spans;
+  size_t i;
+
+  *forward = 1;
+  *backward = 1;
+
+  spans = (sg_move_span_t*)malloc(num_segs * sizeof(sg_move_span_t));
+  if (spans == NULL) return -1;
+  for (i = 0; i < num_segs; i++)
+  {
+    spans[i].src = segs[i].src;
+    spans[i].length = segs[i].length;
+    spans[i].index = i;
+  }
+  qsort(spans, num_segs, sizeof(sg_move_span_t), sg_move_compare);
+
+  // a source mapping some bytes twice defeats the search, and either
+  // order would then read bytes already overwritten
+  for (i = 1; i < num_segs; i++)
+  {
+    if (spans[i - 1].src + spans[i - 1].length > spans[i].src)
+    {
+      *forward = 0;
+      *backward = 0;
+      free(spans);
+      return 0;
+    }
+  }
+
+  for (i = 0; i < num_segs && (*forward || *backward); i++)
+  {
+    const char* lo = segs[i].dest;
+    const char* hi = segs[i].dest + segs[i].length;
+    size_t low = 0;
+    size_t high = num_segs;
+    size_t k;
+
+    // first source ending after lo, the sources being disjoint their
+    // ends are sorted too
+    while (low < high)
+    {
+      size_t mid = low + (high - low) / 2;
+
+      if (spans[mid].src + spans[mid].length <= lo)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+    for (k = low; k < num_segs && spans[k].src < hi; k++)
+    {
+      if (spans[k].index == i)
+        segs[i].overlap = 1;
+      else if (spans[k].index > i)
+        *forward = 0;
+      else
+        *backward = 0;
+    }
+  }
+
+  free(spans);
+
+  return 0;
+}
+
+/*
+* sg_move_bounce Copy the segments of a move through a temporary buffer
+*
+* @in segs      Segments of the move
+* @in num_segs  Number of segments
+* @in count     Number of bytes in the segments
+*
+* @ret          0 on success, -1 on failure
+*/
+static int sg_move_bounce(const sg_move_seg_t* segs, size_t num_segs, size_t count)
+{
+  char* bounce;
+  size_t offset = 0;
+  size_t i;
+
+  bounce = (char*)malloc(count);
+  if (bounce == NULL) return -1;
+
+  for (i = 0; i < num_segs; i++)
+  {
+    sg_kernel_copy(bounce + offset, segs[i].src, segs[i].length);
+    offset += segs[i].length;
+  }
+  offset = 0;
+  for (i = 0; i < num_segs; i++)
+  {
+    sg_kernel_copy(segs[i].dest, bounce + offset, segs[i].length);
+    offset += segs[i].length;
+  }
+
+  free(bounce);
+
+  return 0;
+}
+
+/*
+* sg_move_seg   Copy one segment of a move
+*
+* @in seg       A segment
+*/
+static void sg_move_seg(const sg_move_seg_t* seg)
+{
+  if (seg->overlap)
+  {
+    memmove(seg->dest, seg->src, seg->length);
+    SG_STAT_COPY(seg->length);
+  }
+  else
+  {
+    sg_kernel_copy(seg->dest, seg->src, seg->length);
+  }
+}
+
+/*
+* sg_move       Copy bytes between scatter-gather lists that may overlap
+*
+* @in src       Source sg list
+* @in dest      Destination sg list, may share memory with "src" or be
+*               the same list
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied, 0 on failure
+*
+* @note         Same as sg_copy, except that "dest" ends up holding the
+*               bytes "src" held before the call even when the memory
+*               they map overlaps, as with memmove. Lists that map
+*               disjoint memory are copied as by sg_copy. Otherwise the
+*               segments are copied in whichever order, forward or
+*               backward, reads every source byte before it is
+*               overwritten, with memmove only for segments overlapping
+*               themselves. When neither order does, the bytes go through
+*               a temporary buffer.
+*/
+int sg_move(sg_entry_t* src, sg_entry_t* dest, int src_offset, int count)
+{
+  sg_cursor_t src_cursor;
+  sg_move_seg_t* segs;
+  char* src_lo = NULL;
+  char* src_hi = NULL;
+  char* dest_lo = NULL;
+  char* dest_hi = NULL;
+  size_t num_segs;
+  size_t bytes_copied = 0;
+  size_t i;
+  int forward;
+  int backward;
+
+  // no bytes are copied if one of the parameters is illogical
+  if (dest == NULL) return 0;
+  if (src_offset < 0) return 0;
+  if (count <= 0) return 0;
+
+  if (sg_cursor_init(&src_cursor, src, src_offset) != 0)
+  {
+    SG_STAT_ADD(short_copies, 1);
+    return 0;
+  }
+
+  // lists mapping disjoint address ranges cannot overlap
+  num_segs = sg_move_walk(src_cursor, dest, (size_t)count, NULL,
+                          &src_lo, &src_hi, &dest_lo, &dest_hi);
+  if (num_segs == 0 || src_hi <= dest_lo || dest_hi <= src_lo)
+  {
+    return sg_copy(src, dest, src_offset, count);
+  }
+
+  segs = (sg_move_seg_t*)malloc(num_segs * sizeof(sg_move_seg_t));
+  if (segs == NULL) return 0;
+  sg_move_walk(src_cursor, dest, (size_t)count, segs, NULL, NULL, NULL, NULL);
+  for (i = 0; i < num_segs; i++)
+  {
+    bytes_copied += segs[i].length;
+  }
+
+  if (sg_move_hazards(segs, num_segs, &forward, &backward) != 0)
+  {
+    free(segs);
+    return 0;
+  }
+
+  if (forward)
+  {
+    for (i = 0; i < num_segs; i++)
+    {
+      sg_move_seg(&segs[i]);
+    }
+  }
+  else if (backward)
+  {
+    for (i = num_segs; i > 0; i--)
+    {
+      sg_move_seg(&segs[i - 1]);
+    }
+  }
+  else if (sg_move_bounce(segs, num_segs, bytes_copied) != 0)
+  {
+    bytes_copied = 0;
+  }
+
+  free(segs);
+  if (bytes_copied < (size_t)count) SG_STAT_ADD(short_copies, 1);
+
+  return (int)bytes_copied;
+}
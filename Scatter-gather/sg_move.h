@@ -0,0 +1,29 @@
+#ifndef SG_MOVE_H
+#define SG_MOVE_H
+
+#include "sg_copy.h"
+
+/*
+ * sg_move       Copy bytes between scatter-gather lists that may overlap
+ *
+ * @in src       Source sg list
+ * @in dest      Destination sg list, may share memory with "src" or be
+ *               the same list
+ * @in src_offset Offset into source
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied, 0 on failure
+ *
+ * @note         Same as sg_copy, except that "dest" ends up holding the
+ *               bytes "src" held before the call even when the memory
+ *               they map overlaps, as with memmove. Lists that map
+ *               disjoint memory are copied as by sg_copy. Otherwise the
+ *               segments are copied in whichever order, forward or
+ *               backward, reads every source byte before it is
+ *               overwritten, with memmove only for segments overlapping
+ *               themselves. When neither order does, the bytes go through
+ *               a temporary buffer.
+ */
+extern int sg_move(sg_entry_t *src, sg_entry_t *dest, int src_offset, int count);
+
+#endif /* SG_MOVE_H */
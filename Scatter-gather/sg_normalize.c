@@ -0,0 +1,251 @@
+#include <stdlib.h>
+#include "sg_normalize.h"
+#include "sg_stats.h"
+
+/*
+* Receives the entries of a normalized list, in order
+*/
+typedef void (*sg_normalize_emit_fn)(void* ctx, physaddr_t paddr, int count);
+
+/*
+* In-place normalization state
+*
+* Note: "write" never passes the entry being read, entries are only
+* written once the walk has moved beyond them
+*/
+typedef struct sg_normalize_inplace_s {
+  sg_entry_t* write;              // next entry to write
+  sg_entry_t* last;               // last entry written
+} sg_normalize_inplace_t;
+
+/*
+* sg_normalize_can_merge Tell whether an entry can be appended to a segment
+*
+* @in seg_base  First byte of the segment
+* @in seg_count Number of bytes in the segment
+* @in entry     A non-empty entry
+* @in geom      Geometry bounding the segment
+*
+* @ret          Non-zero if the entry directly follows the segment and
+*               the merged segment stays inside one page
+*/
+static int sg_normalize_can_merge(const char* seg_base, int seg_count,
+                                  const sg_entry_t* entry, const sg_geom_t* geom)
+{
+  size_t page_offset;
+
+  if (seg_base + seg_count != (char*)phys_to_ptr(entry->paddr)) return 0;
+
+  if (geom->page_shift >= 0)
+    page_offset = (size_t)seg_base & ((size_t)geom->page_size - 1);
+  else
+    page_offset = (size_t)seg_base % geom->page_size;
+
+  return page_offset + seg_count + entry->count <= (size_t)geom->page_size;
+}
+
+/*
+* sg_normalize_walk Walk a list and emit its normalized entries
+*
+* @in sg_list   A scatter-gather list
+* @in geom      Geometry bounding the merged entries
+* @in emit      Called once per normalized entry, may be NULL
+* @in ctx       Passed to emit
+* @out entries_before Number of entries in the list, may be NULL
+* @out list_end  Last entry of the list, may be NULL
+*
+* @ret          Number of normalized entries
+*
+* @note         Empty entries are dropped and the walk goes on after them.
+*               It stops before an entry marked SG_ENTRY_FREED: the list
+*               was spliced onto a destroyed one, whose entries are linked
+*               into the allocator's free list and must never be followed.
+*/
+static int sg_normalize_walk(sg_entry_t* sg_list, const sg_geom_t* geom,
+                             sg_normalize_emit_fn emit, void* ctx,
+                             int* entries_before, sg_entry_t** list_end)
+{
+  sg_entry_t* list_curr;
+  sg_entry_t* list_last = NULL;
+  char* seg_base = NULL;
+  int seg_count = 0;
+  int num_before = 0;
+  int num_after = 0;
+
+  for (list_curr = sg_list; list_curr != NULL; list_curr = list_curr->next)
+  {
+    if (list_curr->count < 0) break;
+    num_before++;
+    list_last = list_curr;
+    if (list_curr->count == 0) continue;
+
+    if (seg_count > 0 && sg_normalize_can_merge(seg_base, seg_count, list_curr, geom))
+    {
+      seg_count += list_curr->count;
+      continue;
+    }
+
+    // close the current segment before starting a new one
+    if (seg_count > 0)
+    {
+      if (emit != NULL) emit(ctx, ptr_to_phys(seg_base), seg_count);
+      num_after++;
+    }
+    seg_base = (char*)phys_to_ptr(list_curr->paddr);
+    seg_count = list_curr->count;
+  }
+
+  if (seg_count > 0)
+  {
+    if (emit != NULL) emit(ctx, ptr_to_phys(seg_base), seg_count);
+    num_after++;
+  }
+
+  if (entries_before != NULL) *entries_before = num_before;
+  if (list_end != NULL) *list_end = list_last;
+
+  return num_after;
+}
+
+static void sg_normalize_emit_entry(void* ctx, physaddr_t paddr, int count)
+{
+  sg_normalize_inplace_t* state = (sg_normalize_inplace_t*)ctx;
+
+  state->write->paddr = paddr;
+  state->write->count = count;
+  state->last = state->write;
+  state->write = state->write->next;
+}
+
+static void sg_normalize_emit_table(void* ctx, physaddr_t paddr, int count)
+{
+  sg_table_t* table = (sg_table_t*)ctx;
+  int i = table->num_entries;
+
+  table->paddr[i] = paddr;
+  table->count[i] = count;
+  table->offset[i] = table->length;
+  table->length += count;
+  table->num_entries++;
+}
+
+/*
+* sg_normalize_count Count the entries of a list before and after normalization
+*
+* @in sg_list   A scatter-gather list
+* @in geom      Geometry bounding the merged entries, NULL for sg_default_geom
+* @out entries_before Number of entries in the list, may be NULL
+*
+* @ret          Number of entries the normalized list would have
+*
+* @note         The list is left untouched, this tells whether running
+*               sg_normalize is worth it.
+*/
+int sg_normalize_count(sg_entry_t* sg_list, const sg_geom_t* geom, int* entries_before)
+{
+  if (geom == NULL) geom = &sg_default_geom;
+
+  return sg_normalize_walk(sg_list, geom, NULL, NULL, entries_before, NULL);
+}
+
+/*
+* sg_normalize  Normalize a scatter-gather list in place
+*
+* @in sg_list   A scatter-gather list
+* @in geom      Geometry bounding the merged entries, NULL for sg_default_geom
+* @in allocator The allocator the list was built with, NULL for
+*               sg_default_allocator
+* @out entries_before Number of entries in the list before, may be NULL
+*
+* @ret          Number of entries in the normalized list
+*
+* @note         The normalized list starts at sg_list, the entries it no
+*               longer needs are released to the allocator at once. If the
+*               list holds no bytes, only sg_list is kept, with a count of 0.
+*/
+int sg_normalize(sg_entry_t* sg_list, const sg_geom_t* geom,
+                 const sg_allocator_t* allocator, int* entries_before)
+{
+  sg_normalize_inplace_t state;
+  sg_entry_t* list_end;
+  sg_entry_t* list_curr;
+  sg_entry_t* unused_head;
+  sg_entry_t* unused_tail;
+  int num_unused = 0;
+  int num_after;
+
+  if (entries_before != NULL) *entries_before = 0;
+  if (sg_list == NULL) return 0;
+  if (geom == NULL) geom = &sg_default_geom;
+  if (allocator == NULL) allocator = &sg_default_allocator;
+
+  state.write = sg_list;
+  state.last = NULL;
+  num_after = sg_normalize_walk(sg_list, geom, sg_normalize_emit_entry, &state,
+                                entries_before, &list_end);
+
+  // a destroyed list is left alone
+  if (list_end == NULL) return 0;
+
+  if (state.last == NULL)
+  {
+    sg_list->count = 0;
+    state.last = sg_list;
+  }
+
+  // the entries after the last one written, up to the end of the list, go
+  // back to the allocator. What follows the end belongs to a destroyed list.
+  if (state.last == list_end)
+  {
+    state.last->next = NULL;
+    return num_after;
+  }
+  unused_head = state.last->next;
+  unused_tail = list_end;
+
+  for (list_curr = unused_head; ; list_curr = list_curr->next)
+  {
+    // mark the entry as freed, as sg_destroy does
+    list_curr->count = SG_ENTRY_FREED;
+    num_unused++;
+    if (list_curr == unused_tail) break;
+  }
+  unused_tail->next = NULL;
+  state.last->next = NULL;
+
+  allocator->release(allocator->ctx, unused_head, unused_tail, num_unused);
+  SG_STAT_ADD(entries_freed, num_unused);
+
+  return num_after;
+}
+
+/*
+* sg_normalize_table Build the normalized form of a list as a table
+*
+* @in sg_list   A scatter-gather list
+* @in geom      Geometry bounding the merged entries, NULL for sg_default_geom
+* @out entries_before Number of entries in the list, may be NULL
+*
+* @ret          A table holding the normalized entries, NULL on failure or
+*               if the list holds no bytes
+*
+* @note         The list is left untouched.
+*/
+sg_table_t* sg_normalize_table(sg_entry_t* sg_list, const sg_geom_t* geom,
+                               int* entries_before)
+{
+  sg_table_t* table;
+  int num_after;
+
+  if (geom == NULL) geom = &sg_default_geom;
+
+  num_after = sg_normalize_walk(sg_list, geom, NULL, NULL, entries_before, NULL);
+  if (num_after == 0) return NULL;
+
+  table = sg_table_alloc(num_after);
+  if (table == NULL) return NULL;
+
+  sg_normalize_walk(sg_list, geom, sg_normalize_emit_table, table, NULL, NULL);
+
+  return table;
+}
@@ -0,0 +1,71 @@
+#ifndef SG_NORMALIZE_H
+#define SG_NORMALIZE_H
+
+#include "sg_copy.h"
+#include "sg_alloc.h"
+#include "sg_table.h"
+
+/*
+ * List normalization
+ *
+ * Note: a normalized list has no empty entries, and no entry that
+ * could be merged with the next one: two entries are merged when the
+ * bytes of the second one directly follow the bytes of the first one
+ * and the merged entry stays inside one page of the geometry. Lists
+ * mapped by sg_map are already normalized, lists spliced together or
+ * built from small buffers usually are not. Unlike sg_copy, the list is
+ * walked up to its last entry, empty entries in the middle are dropped.
+ * The walk stops before an entry marked SG_ENTRY_FREED, so a list
+ * spliced onto a destroyed list never reaches into the allocator's free
+ * entries
+ */
+
+/*
+ * sg_normalize_count Count the entries of a list before and after normalization
+ *
+ * @in sg_list   A scatter-gather list
+ * @in geom      Geometry bounding the merged entries, NULL for sg_default_geom
+ * @out entries_before Number of entries in the list, may be NULL
+ *
+ * @ret          Number of entries the normalized list would have
+ *
+ * @note         The list is left untouched, this tells whether running
+ *               sg_normalize is worth it.
+ */
+extern int sg_normalize_count(sg_entry_t *sg_list, const sg_geom_t *geom,
+                              int *entries_before);
+
+/*
+ * sg_normalize  Normalize a scatter-gather list in place
+ *
+ * @in sg_list   A scatter-gather list
+ * @in geom      Geometry bounding the merged entries, NULL for sg_default_geom
+ * @in allocator The allocator the list was built with, NULL for
+ *               sg_default_allocator
+ * @out entries_before Number of entries in the list before, may be NULL
+ *
+ * @ret          Number of entries in the normalized list
+ *
+ * @note         The normalized list starts at sg_list, the entries it no
+ *               longer needs are released to the allocator at once. If the
+ *               list holds no bytes, only sg_list is kept, with a count of 0.
+ */
+extern int sg_normalize(sg_entry_t *sg_list, const sg_geom_t *geom,
+                        const sg_allocator_t *allocator, int *entries_before);
+
+/*
+ * sg_normalize_table Build the normalized form of a list as a table
+ *
+ * @in sg_list   A scatter-gather list
+ * @in geom      Geometry bounding the merged entries, NULL for sg_default_geom
+ * @out entries_before Number of entries in the list, may be NULL
+ *
+ * @ret          A table holding the normalized entries, NULL on failure or
+ *               if the list holds no bytes
+ *
+ * @note         The list is left untouched.
+ */
+extern sg_table_t *sg_normalize_table(sg_entry_t *sg_list, const sg_geom_t *geom,
+                                      int *entries_before);
+
+#endif /* SG_NORMALIZE_H */
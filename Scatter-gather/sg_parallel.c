@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include "sg_parallel.h"
+#include "sg_index.h"
+
+/*
+* One chunk of a parallel copy
+*/
+typedef struct sg_chunk_s {
+  sg_task_t task;                 /* must be first, see sg_task_t */
+  sg_entry_t* src_entry;
+  int offset_in_src_entry;
+  sg_entry_t* dest_entry;
+  int offset_in_dest_entry;
+  int count;
+  int bytes_copied;
+} sg_chunk_t;
+
+static void sg_chunk_run(sg_task_t* task)
+{
+  sg_chunk_t* chunk = (sg_chunk_t*)task;
+
+  chunk->bytes_copied = sg_copy_at(chunk->src_entry, chunk->offset_in_src_entry,
+                                   chunk->dest_entry, chunk->offset_in_dest_entry,
+                                   chunk->count);
+}
+
+/*
+* sg_copy_chunks Split a copy into chunks and run them on a worker pool
+*
+* @in src_index Index of the source sg list
+* @in dest_index Index of the destination sg list
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+* @in workers   Worker pool
+*
+* @ret          Actual number of bytes copied, -1 if the copy was not split
+*
+* @note         Only copies that both lists hold in full, without empty
+*               entries on the way, are split.
+*/
+static int sg_copy_chunks(const sg_index_t* src_index, const sg_index_t* dest_index,
+                          int src_offset, int count, sg_workers_t* workers)
+{
+  sg_chunk_t* chunks;
+  int num_chunks;
+  int chunk_size;
+  int bytes_copied = 0;
+  int i;
+
+  if (src_index == NULL || dest_index == NULL) return -1;
+
+  // sg_copy stops at empty entries, chunks would copy the bytes after them
+  if (src_index->holes || dest_index->holes) return -1;
+
+  // short copies are left to sg_copy, which finds where they end
+  if (src_offset >= src_index->length) return -1;
+  if (count > src_index->length - src_offset) return -1;
+  if (count > dest_index->length) return -1;
+
+  num_chunks = sg_workers_count(workers) + 1;
+  if (num_chunks > count / SG_PARALLEL_MIN_CHUNK) num_chunks = count / SG_PARALLEL_MIN_CHUNK;
+  if (num_chunks <= 1) return -1;
+  chunk_size = (count + num_chunks - 1) / num_chunks;
+
+  chunks = (sg_chunk_t*)malloc(num_chunks * sizeof(sg_chunk_t));
+  if (chunks == NULL) return -1;
+
+  for (i = 0; i < num_chunks; i++)
+  {
+    int offset = i * chunk_size;
+
+    chunks[i].task.run = sg_chunk_run;
+    chunks[i].count = count - offset < chunk_size ? count - offset : chunk_size;
+    chunks[i].bytes_copied = 0;
+    sg_index_seek(src_index, src_offset + offset,
+                  &chunks[i].src_entry, &chunks[i].offset_in_src_entry);
+    sg_index_seek(dest_index, offset,
+                  &chunks[i].dest_entry, &chunks[i].offset_in_dest_entry);
+  }
+
+  sg_workers_run(workers, &chunks[0].task, sizeof(sg_chunk_t), num_chunks);
+
+  for (i = 0; i < num_chunks; i++)
+  {
+    bytes_copied += chunks[i].bytes_copied;
+  }
+  free(chunks);
+
+  return bytes_copied;
+}
+
+/*
+* sg_copy_parallel Copy bytes using scatter-gather lists on a worker pool
+*
+* @in src       Source sg list
+* @in dest      Destination sg list
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+* @in workers   Worker pool, NULL to copy on the calling thread
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same semantics as sg_copy. The byte range is split into
+*               chunks of at least SG_PARALLEL_MIN_CHUNK bytes, one per
+*               worker thread plus the calling thread, whose start entries
+*               are found through an index of each list. Smaller copies,
+*               and copies that run past the end of a list or over an
+*               empty entry, are done by sg_copy.
+*/
+int sg_copy_parallel(sg_entry_t* src, sg_entry_t* dest, int src_offset,
+                     int count, sg_workers_t* workers)
+{
+  sg_index_t* src_index;
+  sg_index_t* dest_index;
+  int bytes_copied;
+
+  // no bytes are copied if one of the parameters is illogical
+  if (dest == NULL) return 0;
+  if (src_offset < 0) return 0;
+  if (count <= 0) return 0;
+
+  if (workers == NULL || count < 2 * SG_PARALLEL_MIN_CHUNK)
+  {
+    return sg_copy(src, dest, src_offset, count);
+  }
+
+  src_index = sg_index_build(src);
+  dest_index = sg_index_build(dest);
+
+  bytes_copied = sg_copy_chunks(src_index, dest_index, src_offset, count, workers);
+  if (bytes_copied < 0) bytes_copied = sg_copy(src, dest, src_offset, count);
+
+  sg_index_destroy(src_index);
+  sg_index_destroy(dest_index);
+
+  return bytes_copied;
+}
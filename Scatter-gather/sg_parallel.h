@@ -0,0 +1,30 @@
+#ifndef SG_PARALLEL_H
+#define SG_PARALLEL_H
+
+#include "sg_copy.h"
+#include "sg_workers.h"
+
+#define SG_PARALLEL_MIN_CHUNK (256 * 1024)	/* smallest byte range per thread */
+
+/*
+ * sg_copy_parallel Copy bytes using scatter-gather lists on a worker pool
+ *
+ * @in src       Source sg list
+ * @in dest      Destination sg list
+ * @in src_offset Offset into source
+ * @in count     Number of bytes to copy
+ * @in workers   Worker pool, NULL to copy on the calling thread
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same semantics as sg_copy. The byte range is split into
+ *               chunks of at least SG_PARALLEL_MIN_CHUNK bytes, one per
+ *               worker thread plus the calling thread, whose start entries
+ *               are found through an index of each list. Smaller copies,
+ *               and copies that run past the end of a list or over an
+ *               empty entry, are done by sg_copy.
+ */
+extern int sg_copy_parallel(sg_entry_t *src, sg_entry_t *dest, int src_offset,
+                            int count, sg_workers_t *workers);
+
+#endif /* SG_PARALLEL_H */
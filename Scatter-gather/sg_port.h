@@ -0,0 +1,93 @@
+#ifndef SG_PORT_H
+#define SG_PORT_H
+
+/*
+ * Compiler portability helpers
+ */
+#if defined(_MSC_VER)
+#define SG_INLINE __inline
+#else
+#define SG_INLINE inline
+#endif
+
+#if defined(_MSC_VER)
+#define SG_THREAD_LOCAL __declspec(thread)
+#else
+#define SG_THREAD_LOCAL __thread
+#endif
+
+/*
+ * SG_TARGET     Compile a function for an instruction set extension
+ *
+ * @note         MSVC emits intrinsics of any extension without flags,
+ *               GCC and clang need the target enabled per function.
+ */
+#if defined(_MSC_VER)
+#define SG_TARGET(isa)
+#else
+#define SG_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+/*
+ * SG_CAS_PTR    Atomically replace a pointer if it still holds a value
+ *
+ * @note         Evaluates to non-zero if *p was "expected" and now holds
+ *               "desired", with a full memory barrier.
+ */
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SG_CAS_PTR(p, expected, desired) \
+	(_InterlockedCompareExchangePointer((void *volatile *)(p), (desired), (expected)) == (expected))
+#else
+#define SG_CAS_PTR(p, expected, desired) __sync_bool_compare_and_swap((p), (expected), (desired))
+#endif
+
+/*
+ * SG_ATOMIC_LOAD Read a value other threads update with SG_CAS_PTR or
+ * SG_ATOMIC_ADD
+ *
+ * @note         Acquire ordering. MSVC gives volatile reads acquire
+ *               semantics, the value must be declared volatile.
+ */
+#if defined(_MSC_VER)
+#define SG_ATOMIC_LOAD(p) (*(p))
+#else
+#define SG_ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#endif
+
+/*
+ * SG_ATOMIC_ADD Atomically add to a long
+ *
+ * @note         Evaluates to the new value of *p, with a full memory
+ *               barrier.
+ */
+#if defined(_MSC_VER)
+#define SG_ATOMIC_ADD(p, n) (_InterlockedExchangeAdd((volatile long *)(p), (n)) + (n))
+#else
+#define SG_ATOMIC_ADD(p, n) __sync_add_and_fetch((p), (n))
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SG_ARCH_X86 1
+#endif
+
+#if defined(_M_ARM64) || defined(__ARM_NEON)
+#define SG_ARCH_NEON 1
+#endif
+
+/*
+ * SG_PREFETCH   Hint that the cache line holding p will be read soon
+ *
+ * @note         Never faults, p may be any address.
+ */
+#if defined(_MSC_VER) && defined(SG_ARCH_X86)
+#define SG_PREFETCH(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+#define SG_PREFETCH(p) __prefetch((const void *)(p))
+#elif defined(__GNUC__)
+#define SG_PREFETCH(p) __builtin_prefetch((const void *)(p))
+#else
+#define SG_PREFETCH(p) ((void)(p))
+#endif
+
+#endif /* SG_PORT_H */
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include "sg_prefetch.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define SG_CALIBRATE_ENTRIES (1 << 16)  // entries of each calibration list
+#define SG_CALIBRATE_ROUNDS 3           // copies timed per distance
+
+/*
+* sg_prefetch_now Read a monotonic clock
+*
+* @ret          Current time in nanoseconds
+*/
+static double sg_prefetch_now(void)
+{
+#if defined(_WIN32)
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER now;
+
+  if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  return (double)now.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#endif
+}
+
+/*
+* sg_prefetch_shuffle Link entries in a random order over random pages
+*
+* @in entries   Array of SG_CALIBRATE_ENTRIES entries to link
+* @in buf       Buffer of SG_CALIBRATE_ENTRIES pages, page aligned
+* @in order     Scratch array of SG_CALIBRATE_ENTRIES ints
+* @in seed      Seed of the shuffle
+*/
+static void sg_prefetch_shuffle(sg_entry_t* entries, char* buf, int* order,
+                                unsigned int seed)
+{
+  int i;
+
+  for (i = 0; i < SG_CALIBRATE_ENTRIES; i++)
+  {
+    order[i] = i;
+  }
+  for (i = SG_CALIBRATE_ENTRIES - 1; i > 0; i--)
+  {
+    int j;
+    int tmp;
+
+    seed = seed * 1103515245 + 12345;
+    j = (int)((seed >> 8) % (unsigned int)(i + 1));
+    tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+
+  // entry order[i] is the i-th of the list and maps page i, so neither
+  // the walk over the entries nor the payloads are sequential
+  for (i = 0; i < SG_CALIBRATE_ENTRIES; i++)
+  {
+    sg_entry_t* next = i + 1 < SG_CALIBRATE_ENTRIES ? &entries[order[i + 1]] : NULL;
+
+    init_entry(&entries[order[i]],
+               ptr_to_phys(buf + (size_t)order[(i * 7) % SG_CALIBRATE_ENTRIES] * PAGE_SIZE),
+               PAGE_SIZE, next);
+  }
+}
+
+/*
+* sg_prefetch_calibrate Pick the prefetch distance for this machine
+*
+* @ret          The distance picked, also set as by sg_set_prefetch_distance,
+*               -1 on failure (the distance is then left unchanged)
+*
+* @note         Times copies between two fragmented lists of a few MiB,
+*               shuffled so that neither their entries nor their payloads
+*               are adjacent in memory, for a few distances. Takes a few
+*               hundred milliseconds.
+*/
+int sg_prefetch_calibrate(void)
+{
+  static const int distances[] = { 0, 1, 2, 4, 8, 16, 32 };
+  int num_distances = sizeof(distances) / sizeof(distances[0]);
+  size_t buf_size = (size_t)SG_CALIBRATE_ENTRIES * PAGE_SIZE;
+  sg_entry_t* src_entries;
+  sg_entry_t* dest_entries;
+  char* src_raw;
+  char* dest_raw;
+  int* order;
+  int saved = sg_get_prefetch_distance();
+  int best = -1;
+  double best_ns = 0;
+  int d;
+
+  src_entries = (sg_entry_t*)malloc(SG_CALIBRATE_ENTRIES * sizeof(sg_entry_t));
+  dest_entries = (sg_entry_t*)malloc(SG_CALIBRATE_ENTRIES * sizeof(sg_entry_t));
+  src_raw = (char*)malloc(buf_size + PAGE_SIZE);
+  dest_raw = (char*)malloc(buf_size + PAGE_SIZE);
+  order = (int*)malloc(SG_CALIBRATE_ENTRIES * sizeof(int));
+
+  if (src_entries != NULL && dest_entries != NULL && src_raw != NULL &&
+      dest_raw != NULL && order != NULL)
+  {
+    // entries must not cross a page boundary, align the payloads
+    char* src_buf = src_raw + (PAGE_SIZE - (size_t)src_raw % PAGE_SIZE) % PAGE_SIZE;
+    char* dest_buf = dest_raw + (PAGE_SIZE - (size_t)dest_raw % PAGE_SIZE) % PAGE_SIZE;
+    int count = SG_CALIBRATE_ENTRIES * PAGE_SIZE;
+    int r;
+
+    sg_prefetch_shuffle(src_entries, src_buf, order, 1);
+    sg_prefetch_shuffle(dest_entries, dest_buf, order, 2);
+    for (r = 0; r < count; r++)
+    {
+      src_buf[r] = (char)r;
+    }
+
+    for (d = 0; d < num_distances; d++)
+    {
+      double ns = 0;
+
+      sg_set_prefetch_distance(distances[d]);
+      for (r = 0; r < SG_CALIBRATE_ROUNDS; r++)
+      {
+        double start = sg_prefetch_now();
+        double elapsed;
+
+        sg_copy(src_entries, dest_entries, 0, count);
+        elapsed = sg_prefetch_now() - start;
+        // the fastest round is the least disturbed one
+        if (r == 0 || elapsed < ns) ns = elapsed;
+      }
+      if (best < 0 || ns < best_ns)
+      {
+        best = distances[d];
+        best_ns = ns;
+      }
+    }
+  }
+
+  sg_set_prefetch_distance(best < 0 ? saved : best);
+
+  free(order);
+  free(dest_raw);
+  free(src_raw);
+  free(dest_entries);
+  free(src_entries);
+
+  return best;
+}
@@ -0,0 +1,97 @@
+#ifndef SG_PREFETCH_H
+#define SG_PREFETCH_H
+
+#include "sg_copy.h"
+#include "sg_port.h"
+
+#define SG_PREFETCH_DISTANCE 4		/* default entries walked ahead of the copy */
+#define SG_PREFETCH_MAX_DISTANCE 64	/* largest distance accepted */
+
+/*
+ * Prefetching list walk
+ *
+ * Note: while the copy loops work on entry N, a second pointer walks
+ * entry N + distance and prefetches both its payload and the header of
+ * the entry after it. The pointer-chase miss on the next header and the
+ * miss on the next payload then overlap with the copy, instead of
+ * following it. The walk stops at the end of the list, or at the first
+ * entry with a non-positive count
+ */
+
+/*
+ * sg_prefetch_start Start a prefetching walk
+ *
+ * @in entry     The entry being copied
+ * @in distance  Number of entries to walk ahead, 0 for no prefetching
+ *
+ * @ret          The entry "distance" entries after "entry", NULL if the
+ *               list is shorter or prefetching is disabled
+ *
+ * @note         Every entry up to there is prefetched on the way.
+ */
+static SG_INLINE sg_entry_t *sg_prefetch_start(sg_entry_t *entry, int distance)
+{
+	int i;
+
+	if (entry == NULL) return NULL;
+
+	for (i = 0; i < distance; i++) {
+		entry = entry->next;
+		if (entry == NULL || entry->count <= 0) return NULL;
+		SG_PREFETCH(entry->next);
+		SG_PREFETCH(phys_to_ptr(entry->paddr));
+	}
+
+	return distance > 0 ? entry : NULL;
+}
+
+/*
+ * sg_prefetch_step Move a prefetching walk one entry ahead
+ *
+ * @in ahead     Current entry of the walk, may be NULL
+ *
+ * @ret          The next entry of the walk, NULL once the list ends
+ */
+static SG_INLINE sg_entry_t *sg_prefetch_step(sg_entry_t *ahead)
+{
+	if (ahead == NULL) return NULL;
+
+	ahead = ahead->next;
+	if (ahead == NULL || ahead->count <= 0) return NULL;
+	SG_PREFETCH(ahead->next);
+	SG_PREFETCH(phys_to_ptr(ahead->paddr));
+
+	return ahead;
+}
+
+/*
+ * sg_set_prefetch_distance Set how far ahead the copy loops prefetch
+ *
+ * @in distance  Number of entries, 0 to disable prefetching
+ *
+ * @note         Meant to be called once at startup, before copies run.
+ *               Defaults to SG_PREFETCH_DISTANCE.
+ */
+extern void sg_set_prefetch_distance(int distance);
+
+/*
+ * sg_get_prefetch_distance Get how far ahead the copy loops prefetch
+ *
+ * @ret          Number of entries, 0 if prefetching is disabled
+ */
+extern int sg_get_prefetch_distance(void);
+
+/*
+ * sg_prefetch_calibrate Pick the prefetch distance for this machine
+ *
+ * @ret          The distance picked, also set as by sg_set_prefetch_distance,
+ *               -1 on failure (the distance is then left unchanged)
+ *
+ * @note         Times copies between two fragmented lists of a few MiB,
+ *               shuffled so that neither their entries nor their payloads
+ *               are adjacent in memory, for a few distances. Takes a few
+ *               hundred milliseconds.
+ */
+extern int sg_prefetch_calibrate(void);
+
+#endif /* SG_PREFETCH_H */
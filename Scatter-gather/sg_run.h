@@ -0,0 +1,92 @@
+#ifndef SG_RUN_H
+#define SG_RUN_H
+
+#include <stddef.h>
+#include "sg_copy.h"
+#include "sg_kernel.h"
+#include "sg_csum.h"
+
+#define SG_RUN_NT 0x1	/* copy with non-temporal stores */
+
+/*
+ * Pending copy run
+ *
+ * Note: the copy loops add every src/dest overlap to a run instead of
+ * copying it right away. Overlaps that continue the run on both sides
+ * (in virtual address space, where memcpy works) only extend it, so
+ * segments that are contiguous on both sides are copied in one go.
+ * When crc is not NULL, runs are copied and checksummed in one pass,
+ * otherwise "flags" picks the copy kernel
+ */
+typedef struct sg_run_s sg_run_t;
+struct sg_run_s {
+	char *dest;                     /* first destination byte of the run */
+	const char *src;                /* first source byte of the run */
+	size_t length;                  /* number of bytes in the run */
+	unsigned int *crc;              /* running CRC32C of the bytes copied, or NULL */
+	int flags;                      /* SG_RUN_* flags */
+};
+
+/*
+ * sg_run_init   Start an empty copy run
+ *
+ * @in run       A copy run
+ * @in crc       Running CRC32C to update with the bytes copied, NULL for
+ *               a plain copy
+ * @in flags     SG_RUN_* flags
+ */
+static SG_INLINE void sg_run_init(sg_run_t *run, unsigned int *crc, int flags)
+{
+	run->dest = NULL;
+	run->src = NULL;
+	run->length = 0;
+	run->crc = crc;
+	run->flags = flags;
+}
+
+/*
+ * sg_run_flush  Copy the pending run and empty it
+ *
+ * @in run       A copy run
+ */
+static SG_INLINE void sg_run_flush(sg_run_t *run)
+{
+	if (run->length > 0) {
+		if (run->crc != NULL)
+			*run->crc = sg_crc32c_copy(run->dest, run->src, run->length, *run->crc);
+		else if (run->flags & SG_RUN_NT)
+			sg_kernel_copy_nt(run->dest, run->src, run->length);
+		else
+			sg_kernel_copy(run->dest, run->src, run->length);
+	}
+	run->length = 0;
+}
+
+/*
+ * sg_run_add    Add a segment to a copy run
+ *
+ * @in run       A copy run
+ * @in dest      Destination of the segment
+ * @in src       Source of the segment
+ * @in length    Number of bytes in the segment
+ *
+ * @note         Flushes the pending run first if the segment does not
+ *               continue it on both sides.
+ */
+static SG_INLINE void sg_run_add(sg_run_t *run, void *dest, const void *src, int length)
+{
+	if (run->length > 0 &&
+	    (char *)dest == run->dest + run->length &&
+	    (const char *)src == run->src + run->length)
+	{
+		run->length += length;
+		return;
+	}
+
+	sg_run_flush(run);
+	run->dest = (char *)dest;
+	run->src = (const char *)src;
+	run->length = length;
+}
+
+#endif /* SG_RUN_H */
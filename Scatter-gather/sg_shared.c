@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sg_shared.h"
+#include "sg_port.h"
+
+/*
+* sg_share      Turn a list into a reference-counted shared list
+*
+* @in list      Owning list, left empty
+* @in release   Called to free the payload with the last reference, may
+*               be NULL if the payload outlives the list
+* @in ctx       Passed to release
+*
+* @ret          The shared list, holding one reference, NULL on failure
+*               (the list is then left untouched)
+*/
+sg_shared_t* sg_share(sg_list_t* list, sg_shared_release_cb release, void* ctx)
+{
+  sg_shared_t* shared;
+
+  if (list == NULL) return NULL;
+  // views do not own their entries
+  if (list->allocator == NULL) return NULL;
+
+  shared = (sg_shared_t*)malloc(sizeof(sg_shared_t));
+  if (shared == NULL) return NULL;
+
+  shared->refs = 1;
+  shared->list = *list;
+  shared->release = release;
+  shared->ctx = ctx;
+
+  list->head = NULL;
+  list->tail = NULL;
+  list->head_offset = 0;
+  list->num_entries = 0;
+  list->length = 0;
+
+  return shared;
+}
+
+/*
+* sg_ref        Take one more reference to a shared list
+*
+* @in shared    A shared list the caller holds a reference to
+*
+* @ret          "shared"
+*
+* @note         A single atomic increment, nothing is copied.
+*/
+sg_shared_t* sg_ref(sg_shared_t* shared)
+{
+  if (shared != NULL) SG_ATOMIC_ADD(&shared->refs, 1);
+
+  return shared;
+}
+
+/*
+* sg_unref      Drop a reference to a shared list
+*
+* @in shared    A shared list the caller holds a reference to, may be NULL
+*
+* @note         The last reference releases the entries, calls the release
+*               callback and frees "shared".
+*/
+void sg_unref(sg_shared_t* shared)
+{
+  if (shared == NULL) return;
+  if (SG_ATOMIC_ADD(&shared->refs, -1) != 0) return;
+
+  // the barrier of the decrement orders every holder's reads before this
+  sg_list_destroy(&shared->list);
+  if (shared->release != NULL) shared->release(shared->ctx);
+  free(shared);
+}
+
+/*
+* sg_cow_slice  Make a copy-on-write slice of a shared list
+*
+* @in shared    A shared list the caller holds a reference to
+* @in offset    Offset of the slice into the list
+* @in length    Number of bytes in the slice
+* @out cow      The slice, holding a reference of its own
+*
+* @ret          0 on success, -1 if the range is not inside the list
+*
+* @note         Nothing is allocated or copied, as in sg_slice.
+*/
+int sg_cow_slice(sg_shared_t* shared, size_t offset, size_t length, sg_cow_t* cow)
+{
+  if (shared == NULL || cow == NULL) return -1;
+
+  if (sg_slice(&shared->list, offset, length, &cow->list) != 0) return -1;
+  cow->shared = sg_ref(shared);
+  cow->buf = NULL;
+
+  return 0;
+}
+
+/*
+* sg_cow_write  Make the bytes of a slice writable
+*
+* @in cow       A copy-on-write slice
+*
+* @ret          The list to write the slice through, NULL on failure
+*
+* @note         A slice holding the only reference to its shared list is
+*               written in place. Otherwise its bytes are copied into a
+*               private buffer first, and the reference is dropped.
+*/
+sg_list_t* sg_cow_write(sg_cow_t* cow)
+{
+  sg_list_t copy;
+  void* buf;
+
+  if (cow == NULL) return NULL;
+
+  // no other holder is left to take a new reference, so once the count
+  // is seen at 1 it stays there
+  if (cow->shared == NULL || cow->shared->refs == 1) return &cow->list;
+
+  // an empty slice has nothing to copy
+  if (cow->list.length == 0)
+  {
+    sg_unref(cow->shared);
+    cow->shared = NULL;
+    return &cow->list;
+  }
+
+  buf = malloc(cow->list.length);
+  if (buf == NULL) return NULL;
+  if (sg_list_map(&copy, buf, cow->list.length, NULL, NULL) != 0)
+  {
+    free(buf);
+    return NULL;
+  }
+  sg_list_copy(&cow->list, 0, &copy, cow->list.length);
+
+  sg_unref(cow->shared);
+  cow->shared = NULL;
+  cow->list = copy;
+  cow->buf = buf;
+
+  return &cow->list;
+}
+
+/*
+* sg_cow_release Release a copy-on-write slice
+*
+* @in cow       A copy-on-write slice, left empty
+*/
+void sg_cow_release(sg_cow_t* cow)
+{
+  if (cow == NULL) return;
+
+  if (cow->shared != NULL)
+  {
+    sg_unref(cow->shared);
+  }
+  else if (cow->buf != NULL)
+  {
+    sg_list_destroy(&cow->list);
+    free(cow->buf);
+  }
+
+  memset(cow, 0, sizeof(sg_cow_t));
+}
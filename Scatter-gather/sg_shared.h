@@ -0,0 +1,116 @@
+#ifndef SG_SHARED_H
+#define SG_SHARED_H
+
+#include <stddef.h>
+#include "sg_list.h"
+
+/*
+ * Payload release callback
+ *
+ * Note: called once the last reference to a shared list is dropped,
+ * after its entries are released, on the thread dropping it
+ */
+typedef void (*sg_shared_release_cb)(void *ctx);
+
+/*
+ * Reference-counted scatter-gather list
+ *
+ * Note: owns a list and, through "release", the memory it maps. Every
+ * holder of a reference may read the list from any thread, none may
+ * write the payload while another reference exists. The entries and
+ * the payload are released when the last reference is dropped
+ */
+typedef struct sg_shared_s sg_shared_t;
+struct sg_shared_s {
+	volatile long refs;             /* number of references held */
+	sg_list_t list;                 /* the shared list, owning its entries */
+	sg_shared_release_cb release;   /* frees the payload, may be NULL */
+	void *ctx;                      /* passed to release */
+};
+
+/*
+ * Copy-on-write slice
+ *
+ * Note: a range of a shared list, holding one reference to it, until
+ * sg_cow_write gives the slice a private copy of its bytes. "list" is
+ * a view of the shared entries while "shared" is set, and an owning
+ * list of "buf" afterwards
+ */
+typedef struct sg_cow_s sg_cow_t;
+struct sg_cow_s {
+	sg_shared_t *shared;            /* shared list read from, NULL once private */
+	sg_list_t list;                 /* the bytes of the slice */
+	void *buf;                      /* private copy of the bytes, NULL while shared */
+};
+
+/*
+ * sg_share      Turn a list into a reference-counted shared list
+ *
+ * @in list      Owning list, left empty
+ * @in release   Called to free the payload with the last reference, may
+ *               be NULL if the payload outlives the list
+ * @in ctx       Passed to release
+ *
+ * @ret          The shared list, holding one reference, NULL on failure
+ *               (the list is then left untouched)
+ */
+extern sg_shared_t *sg_share(sg_list_t *list, sg_shared_release_cb release,
+                             void *ctx);
+
+/*
+ * sg_ref        Take one more reference to a shared list
+ *
+ * @in shared    A shared list the caller holds a reference to
+ *
+ * @ret          "shared"
+ *
+ * @note         A single atomic increment, nothing is copied.
+ */
+extern sg_shared_t *sg_ref(sg_shared_t *shared);
+
+/*
+ * sg_unref      Drop a reference to a shared list
+ *
+ * @in shared    A shared list the caller holds a reference to, may be NULL
+ *
+ * @note         The last reference releases the entries, calls the release
+ *               callback and frees "shared".
+ */
+extern void sg_unref(sg_shared_t *shared);
+
+/*
+ * sg_cow_slice  Make a copy-on-write slice of a shared list
+ *
+ * @in shared    A shared list the caller holds a reference to
+ * @in offset    Offset of the slice into the list
+ * @in length    Number of bytes in the slice
+ * @out cow      The slice, holding a reference of its own
+ *
+ * @ret          0 on success, -1 if the range is not inside the list
+ *
+ * @note         Nothing is allocated or copied, as in sg_slice.
+ */
+extern int sg_cow_slice(sg_shared_t *shared, size_t offset, size_t length,
+                        sg_cow_t *cow);
+
+/*
+ * sg_cow_write  Make the bytes of a slice writable
+ *
+ * @in cow       A copy-on-write slice
+ *
+ * @ret          The list to write the slice through, NULL on failure
+ *
+ * @note         A slice holding the only reference to its shared list is
+ *               written in place. Otherwise its bytes are copied into a
+ *               private buffer first, and the reference is dropped.
+ */
+extern sg_list_t *sg_cow_write(sg_cow_t *cow);
+
+/*
+ * sg_cow_release Release a copy-on-write slice
+ *
+ * @in cow       A copy-on-write slice, left empty
+ */
+extern void sg_cow_release(sg_cow_t *cow);
+
+#endif /* SG_SHARED_H */
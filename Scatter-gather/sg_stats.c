@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sg_stats.h"
+#include "sg_port.h"
+
+#if defined(SG_STATS)
+/*
+* Counters of one thread
+*
+* Note: blocks are pushed on a global list the first time a thread
+* counts something and are never freed, so readers can walk the list
+* without locks while threads come and go
+*/
+typedef struct sg_stats_block_s {
+  sg_stats_t stats;
+  struct sg_stats_block_s* next;
+} sg_stats_block_t;
+
+static sg_stats_block_t* volatile sg_stats_blocks;
+static SG_THREAD_LOCAL sg_stats_block_t* sg_stats_local;
+
+// counts of threads whose block could not be allocated
+static sg_stats_block_t sg_stats_shared;
+
+/*
+* sg_stats_thread Counters of the calling thread, registered on first use
+*
+* @ret          The calling thread's counters
+*/
+sg_stats_t* sg_stats_thread(void)
+{
+  sg_stats_block_t* block = sg_stats_local;
+  sg_stats_block_t* head;
+
+  if (block != NULL) return &block->stats;
+
+  block = (sg_stats_block_t*)calloc(1, sizeof(sg_stats_block_t));
+  if (block == NULL) return &sg_stats_shared.stats;
+
+  do
+  {
+    head = sg_stats_blocks;
+    block->next = head;
+  } while (!SG_CAS_PTR(&sg_stats_blocks, head, block));
+
+  sg_stats_local = block;
+
+  return &block->stats;
+}
+
+/*
+* sg_stats_count_copy Count one memcpy
+*
+* @in length    Number of bytes copied
+*/
+void sg_stats_count_copy(size_t length)
+{
+  sg_stats_t* stats = sg_stats_thread();
+  int bucket = 0;
+
+  while (bucket < SG_STATS_HIST_BUCKETS - 1 && (length >> (bucket + 1)) != 0)
+  {
+    bucket++;
+  }
+
+  stats->copies++;
+  stats->copy_hist[bucket]++;
+  stats->bytes_copied += length;
+}
+
+/*
+* sg_stats_add  Add a set of counters to another
+*
+* @in sum       Counters to add to
+* @in stats     Counters to add
+*/
+static void sg_stats_add(sg_stats_t* sum, const sg_stats_t* stats)
+{
+  int i;
+
+  sum->seek_entries += stats->seek_entries;
+  sum->copies += stats->copies;
+  for (i = 0; i < SG_STATS_HIST_BUCKETS; i++)
+  {
+    sum->copy_hist[i] += stats->copy_hist[i];
+  }
+  sum->bytes_copied += stats->bytes_copied;
+  sum->short_copies += stats->short_copies;
+  sum->entries_allocated += stats->entries_allocated;
+  sum->entries_freed += stats->entries_freed;
+  sum->slab_refills += stats->slab_refills;
+  sum->slabs_freed += stats->slabs_freed;
+  sum->depot_puts += stats->depot_puts;
+  sum->depot_gets += stats->depot_gets;
+}
+#endif
+
+/*
+* sg_stats_enabled Tell whether the library maintains its counters
+*
+* @ret          Non-zero if the library was built with SG_STATS
+*/
+int sg_stats_enabled(void)
+{
+#if defined(SG_STATS)
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+/*
+* sg_stats_snapshot Sum the counters of every thread
+*
+* @out stats    Counters of all the threads that ever used the library
+*
+* @note         Lock-free. Threads still copying may be caught mid-update,
+*               so each counter is exact only once they are quiescent.
+*               The counters of exited threads are kept.
+*/
+void sg_stats_snapshot(sg_stats_t* stats)
+{
+#if defined(SG_STATS)
+  sg_stats_block_t* block;
+#endif
+
+  if (stats == NULL) return;
+  memset(stats, 0, sizeof(sg_stats_t));
+
+#if defined(SG_STATS)
+  for (block = sg_stats_blocks; block != NULL; block = block->next)
+  {
+    sg_stats_add(stats, &block->stats);
+  }
+  sg_stats_add(stats, &sg_stats_shared.stats);
+#endif
+}
+
+/*
+* sg_stats_thread_snapshot Read the counters of the calling thread
+*
+* @out stats    Counters of the calling thread
+*/
+void sg_stats_thread_snapshot(sg_stats_t* stats)
+{
+  if (stats == NULL) return;
+
+#if defined(SG_STATS)
+  *stats = *sg_stats_thread();
+#else
+  memset(stats, 0, sizeof(sg_stats_t));
+#endif
+}
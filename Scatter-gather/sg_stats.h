@@ -0,0 +1,82 @@
+#ifndef SG_STATS_H
+#define SG_STATS_H
+
+#define SG_STATS_HIST_BUCKETS 24	/* memcpy size classes, powers of two */
+
+/*
+ * Hot-path counters
+ *
+ * Note: only maintained when the library is built with SG_STATS
+ * defined, otherwise every counter stays zero and the hooks compile to
+ * nothing. Each thread updates its own counters without locks or
+ * atomic operations. copy_hist[i] counts the memcpys of 2^i to
+ * 2^(i+1) - 1 bytes, the last bucket also counts every larger one
+ */
+typedef struct sg_stats_s sg_stats_t;
+struct sg_stats_s {
+	unsigned long long seek_entries;        /* entries skipped to reach a source offset */
+	unsigned long long copies;              /* memcpys issued, after coalescing */
+	unsigned long long copy_hist[SG_STATS_HIST_BUCKETS];
+	unsigned long long bytes_copied;        /* bytes moved by those memcpys */
+	unsigned long long short_copies;        /* copies returning fewer bytes than asked */
+	unsigned long long entries_allocated;   /* entries taken from allocators */
+	unsigned long long entries_freed;       /* entries given back to allocators */
+	unsigned long long slab_refills;        /* slabs malloc'ed by the default pool */
+	unsigned long long slabs_freed;         /* slabs the default pool gave back */
+	unsigned long long depot_puts;          /* batches handed to the shared depot */
+	unsigned long long depot_gets;          /* batches taken from the shared depot */
+};
+
+/*
+ * sg_stats_enabled Tell whether the library maintains its counters
+ *
+ * @ret          Non-zero if the library was built with SG_STATS
+ */
+extern int sg_stats_enabled(void);
+
+/*
+ * sg_stats_snapshot Sum the counters of every thread
+ *
+ * @out stats    Counters of all the threads that ever used the library
+ *
+ * @note         Lock-free. Threads still copying may be caught mid-update,
+ *               so each counter is exact only once they are quiescent.
+ *               The counters of exited threads are kept.
+ */
+extern void sg_stats_snapshot(sg_stats_t *stats);
+
+/*
+ * sg_stats_thread_snapshot Read the counters of the calling thread
+ *
+ * @out stats    Counters of the calling thread
+ */
+extern void sg_stats_thread_snapshot(sg_stats_t *stats);
+
+/*
+ * Hooks used inside the library
+ */
+#if defined(SG_STATS)
+#include <stddef.h>
+
+/*
+ * sg_stats_thread Counters of the calling thread, registered on first use
+ *
+ * @ret          The calling thread's counters
+ */
+extern sg_stats_t *sg_stats_thread(void);
+
+/*
+ * sg_stats_count_copy Count one memcpy
+ *
+ * @in length    Number of bytes copied
+ */
+extern void sg_stats_count_copy(size_t length);
+
+#define SG_STAT_ADD(field, n) (sg_stats_thread()->field += (n))
+#define SG_STAT_COPY(length) sg_stats_count_copy(length)
+#else
+#define SG_STAT_ADD(field, n) ((void)(n))
+#define SG_STAT_COPY(length) ((void)(length))
+#endif
+
+#endif /* SG_STATS_H */
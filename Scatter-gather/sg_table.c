@@ -0,0 +1,301 @@
+#include <stdlib.h>
+#include "sg_table.h"
+#include "sg_alloc.h"
+#include "sg_index.h"
+#include "sg_run.h"
+#include "sg_stats.h"
+
+/*
+* sg_table_alloc Allocate a table with room for a number of entries
+*
+* @in num_entries Number of entries
+*
+* @ret          An empty table, NULL on failure
+*
+* @note         The table header and its arrays share one allocation,
+*               the table is destroyed with sg_table_destroy.
+*/
+sg_table_t* sg_table_alloc(int num_entries)
+{
+  sg_table_t* table;
+
+  if (num_entries <= 0) return NULL;
+
+  table = (sg_table_t*)malloc(sizeof(sg_table_t) +
+                              num_entries * sizeof(physaddr_t) +
+                              2 * num_entries * sizeof(int));
+  if (table == NULL) return NULL;
+
+  table->paddr = (physaddr_t*)(table + 1);
+  table->count = (int*)(table->paddr + num_entries);
+  table->offset = table->count + num_entries;
+  table->num_entries = 0;
+  table->length = 0;
+
+  return table;
+}
+
+/*
+* sg_map_table  Map a memory buffer using a scatter-gather table
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+*
+* @ret          A table mapping the input buffer, NULL on failure
+*
+* @note         The entries are the same as the ones sg_map makes,
+*               the table is allocated with a single allocation.
+*/
+sg_table_t* sg_map_table(void* buf, int length)
+{
+  return sg_map_table_geom(buf, length, &sg_default_geom);
+}
+
+/*
+* sg_map_table_geom Map a memory buffer using a table and a given geometry
+*
+* @in buf       Pointer to buffer
+* @in length    Buffer length in bytes
+* @in geom      Mapping geometry, NULL for sg_default_geom
+*
+* @ret          A table mapping the input buffer, NULL on failure
+*
+* @note         Same as sg_map_table, with entries mapping up to
+*               geom->page_size bytes each.
+*/
+sg_table_t* sg_map_table_geom(void* buf, int length, const sg_geom_t* geom)
+{
+  sg_table_t* table;
+  int head_count;
+  int num_full_pages;
+  int tail_count;
+  int num_entries;
+  int total_count;
+  int i;
+
+  // check for illegal input parameters
+  if (buf == NULL) return NULL;
+  if (length <= 0) return NULL;
+  if (geom == NULL) geom = &sg_default_geom;
+
+  num_entries = sg_map_layout_geom(buf, length, geom,
+                                   &head_count, &num_full_pages, &tail_count);
+
+  table = sg_table_alloc(num_entries);
+  if (table == NULL) return NULL;
+
+  total_count = 0;
+  for (i = 0; i < num_entries; i++)
+  {
+    int count = i == 0 ? head_count : geom->page_size;
+
+    if (i == num_entries - 1 && tail_count > 0) count = tail_count;
+
+    table->paddr[i] = ptr_to_phys((char*)buf + total_count);
+    table->count[i] = count;
+    table->offset[i] = total_count;
+    total_count += count;
+  }
+  table->num_entries = num_entries;
+  table->length = length;
+
+  return table;
+}
+
+/*
+* sg_table_destroy Destroy a scatter-gather table
+*
+* @in table     A scatter-gather table
+*/
+void sg_table_destroy(sg_table_t* table)
+{
+  free(table);
+}
+
+/*
+* sg_copy_table Copy bytes using scatter-gather tables
+*
+* @in src       Source sg table
+* @in dest      Destination sg table
+* @in src_offset Offset into source
+* @in count     Number of bytes to copy
+*
+* @ret          Actual number of bytes copied
+*
+* @note         Same semantics as sg_copy, an entry with a count of 0
+*               ends the copy.
+*/
+int sg_copy_table(const sg_table_t* src, const sg_table_t* dest,
+                  int src_offset, int count)
+{
+  int src_index;
+  int dest_index = 0;
+  int bytes_copied = 0;
+  int offset_in_src_entry;
+  int offset_in_dest_entry = 0;
+  sg_run_t run;
+
+  // no bytes are copied if one of the parameters is illogical
+  if (src == NULL) return 0;
+  if (dest == NULL) return 0;
+  if (src_offset < 0) return 0;
+  if (count <= 0) return 0;
+
+  if (sg_table_seek(src, src_offset, &src_index, &offset_in_src_entry) != 0)
+  {
+    SG_STAT_ADD(short_copies, 1);
+    return 0;
+  }
+
+  // overlaps are accumulated and copied once they stop being contiguous
+  sg_run_init(&run, NULL, 0);
+
+  while (bytes_copied < count &&
+         src_index < src->num_entries && dest_index < dest->num_entries)
+  {
+    int remaining_bytes_in_src_entry = src->count[src_index] - offset_in_src_entry;
+    int remaining_bytes_in_dest_entry = dest->count[dest_index] - offset_in_dest_entry;
+    int bytes_to_copy = count - bytes_copied;
+
+    // an empty entry ends the copy, as in sg_copy
+    if (src->count[src_index] <= 0) break;
+    if (dest->count[dest_index] <= 0) break;
+
+    if (bytes_to_copy > remaining_bytes_in_src_entry)
+      bytes_to_copy = remaining_bytes_in_src_entry;
+    if (bytes_to_copy > remaining_bytes_in_dest_entry)
+      bytes_to_copy = remaining_bytes_in_dest_entry;
+
+    sg_run_add(&run,
+               (char*)phys_to_ptr(dest->paddr[dest_index]) + offset_in_dest_entry,
+               (char*)phys_to_ptr(src->paddr[src_index]) + offset_in_src_entry,
+               bytes_to_copy);
+    bytes_copied += bytes_to_copy;
+
+    // advance whichever entries were used up
+    offset_in_src_entry += bytes_to_copy;
+    if (offset_in_src_entry == src->count[src_index])
+    {
+      src_index++;
+      offset_in_src_entry = 0;
+    }
+    offset_in_dest_entry += bytes_to_copy;
+    if (offset_in_dest_entry == dest->count[dest_index])
+    {
+      dest_index++;
+      offset_in_dest_entry = 0;
+    }
+  }
+  sg_run_flush(&run);
+  if (bytes_copied < count) SG_STAT_ADD(short_copies, 1);
+
+  return bytes_copied;
+}
+
+/*
+* sg_table_seek Find the entry holding a given offset into a table
+*
+* @in table     A scatter-gather table
+* @in offset    Offset into the table
+* @out entry_index The index of the entry holding the byte at "offset"
+* @out intra_offset Offset of that byte inside the entry
+*
+* @ret          0 on success, -1 if the table is shorter than "offset"
+*
+* @note         A binary search over the offset array. An empty entry
+*               shares its offset with the entry after it, which is the
+*               one found.
+*/
+int sg_table_seek(const sg_table_t* table, int offset,
+                  int* entry_index, int* intra_offset)
+{
+  int i;
+
+  if (table == NULL) return -1;
+  if (offset < 0 || offset >= table->length) return -1;
+
+  i = sg_offset_search(table->offset, table->num_entries, offset);
+  *entry_index = i;
+  *intra_offset = offset - table->offset[i];
+
+  return 0;
+}
+
+/*
+* sg_table_from_list Build a scatter-gather table from a list
+*
+* @in sg_list   A scatter-gather list
+*
+* @ret          A table holding the entries of the list, NULL on failure
+*
+* @note         Empty entries followed by a non-empty one are kept with a
+*               count of 0, so sg_table_seek and sg_copy_table treat them
+*               as sg_seek and sg_copy do. The list is left untouched.
+*/
+sg_table_t* sg_table_from_list(sg_entry_t* sg_list)
+{
+  sg_table_t* table;
+  sg_entry_t* list_curr;
+  int num_entries = 0;
+  int num_walked = 0;
+  int i;
+
+  if (sg_list == NULL) return NULL;
+
+  // trailing empty entries are left out, no copy could go beyond them
+  for (list_curr = sg_list; list_curr != NULL; list_curr = list_curr->next)
+  {
+    num_walked++;
+    if (list_curr->count > 0) num_entries = num_walked;
+  }
+  if (num_entries == 0) return NULL;
+
+  table = sg_table_alloc(num_entries);
+  if (table == NULL) return NULL;
+
+  list_curr = sg_list;
+  for (i = 0; i < num_entries; i++)
+  {
+    table->paddr[i] = list_curr->paddr;
+    table->count[i] = list_curr->count > 0 ? list_curr->count : 0;
+    table->offset[i] = table->length;
+    table->length += table->count[i];
+    list_curr = list_curr->next;
+  }
+  table->num_entries = num_entries;
+
+  return table;
+}
+
+/*
+* sg_table_to_list Build a scatter-gather list from a table
+*
+* @in table     A scatter-gather table
+*
+* @ret          A list holding the entries of the table, NULL on failure
+*
+* @note         The list is destroyed with sg_destroy.
+*/
+sg_entry_t* sg_table_to_list(const sg_table_t* table)
+{
+  sg_entry_t* list_head;
+  sg_entry_t* list_curr;
+  int i;
+
+  if (table == NULL) return NULL;
+  if (table->num_entries <= 0) return NULL;
+
+  list_head = sg_default_allocator.alloc(sg_default_allocator.ctx,
+                                         table->num_entries);
+  if (list_head == NULL) return NULL;
+  SG_STAT_ADD(entries_allocated, table->num_entries);
+
+  list_curr = list_head;
+  for (i = 0; i < table->num_entries; i++)
+  {
+    init_entry(list_curr, table->paddr[i], table->count[i], list_curr->next);
+    list_curr = list_curr->next;
+  }
+
+  return list_head;
+}
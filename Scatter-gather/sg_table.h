@@ -0,0 +1,126 @@
+#ifndef SG_TABLE_H
+#define SG_TABLE_H
+
+#include "sg_copy.h"
+
+/*
+ * Array-backed scatter-gather table
+ *
+ * Note: entry i maps count[i] bytes at physical address paddr[i], with the
+ * same rules as sg_entry_s. The addresses and counts are kept in separate
+ * arrays so walking the table is a linear scan over each of them.
+ * offset[i] is the offset into the table of the first byte of entry i
+ */
+typedef struct sg_table_s sg_table_t;
+struct sg_table_s {
+	physaddr_t *paddr;              /* physical address of each entry */
+	int *count;                     /* number of bytes of each entry */
+	int *offset;                    /* offset of the first byte of each entry */
+	int num_entries;                /* number of entries in the table */
+	int length;                     /* total number of bytes mapped */
+};
+
+/*
+ * sg_table_alloc Allocate a table with room for a number of entries
+ *
+ * @in num_entries Number of entries, positive
+ *
+ * @ret          An empty table, NULL on failure
+ *
+ * @note         The table header and its arrays share one allocation,
+ *               the table is destroyed with sg_table_destroy.
+ */
+extern sg_table_t *sg_table_alloc(int num_entries);
+
+/*
+ * sg_map_table  Map a memory buffer using a scatter-gather table
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ *
+ * @ret          A table mapping the input buffer, NULL on failure
+ *
+ * @note         The entries are the same as the ones sg_map makes,
+ *               the table is allocated with a single allocation.
+ */
+extern sg_table_t *sg_map_table(void *buf, int length);
+
+/*
+ * sg_map_table_geom Map a memory buffer using a table and a given geometry
+ *
+ * @in buf       Pointer to buffer
+ * @in length    Buffer length in bytes
+ * @in geom      Mapping geometry, NULL for sg_default_geom
+ *
+ * @ret          A table mapping the input buffer, NULL on failure
+ *
+ * @note         Same as sg_map_table, with entries mapping up to
+ *               geom->page_size bytes each.
+ */
+extern sg_table_t *sg_map_table_geom(void *buf, int length, const sg_geom_t *geom);
+
+/*
+ * sg_table_destroy Destroy a scatter-gather table
+ *
+ * @in table     A scatter-gather table
+ */
+extern void sg_table_destroy(sg_table_t *table);
+
+/*
+ * sg_copy_table Copy bytes using scatter-gather tables
+ *
+ * @in src       Source sg table
+ * @in dest      Destination sg table
+ * @in src_offset Offset into source
+ * @in count     Number of bytes to copy
+ *
+ * @ret          Actual number of bytes copied
+ *
+ * @note         Same semantics as sg_copy, an entry with a count of 0
+ *               ends the copy.
+ */
+extern int sg_copy_table(const sg_table_t *src, const sg_table_t *dest,
+                         int src_offset, int count);
+
+/*
+ * sg_table_seek Find the entry holding a given offset into a table
+ *
+ * @in table     A scatter-gather table
+ * @in offset    Offset into the table
+ * @out entry_index The index of the entry holding the byte at "offset"
+ * @out intra_offset Offset of that byte inside the entry
+ *
+ * @ret          0 on success, -1 if the table is shorter than "offset"
+ *
+ * @note         A binary search over the offset array. An empty entry
+ *               shares its offset with the entry after it, which is the
+ *               one found.
+ */
+extern int sg_table_seek(const sg_table_t *table, int offset,
+                         int *entry_index, int *intra_offset);
+
+/*
+ * sg_table_from_list Build a scatter-gather table from a list
+ *
+ * @in sg_list   A scatter-gather list
+ *
+ * @ret          A table holding the entries of the list, NULL on failure
+ *
+ * @note         Empty entries followed by a non-empty one are kept with a
+ *               count of 0, so sg_table_seek and sg_copy_table treat them
+ *               as sg_seek and sg_copy do. The list is left untouched.
+ */
+extern sg_table_t *sg_table_from_list(sg_entry_t *sg_list);
+
+/*
+ * sg_table_to_list Build a scatter-gather list from a table
+ *
+ * @in table     A scatter-gather table
+ *
+ * @ret          A list holding the entries of the table, NULL on failure
+ *
+ * @note         The list is destroyed with sg_destroy.
+ */
+extern sg_entry_t *sg_table_to_list(const sg_table_t *table);
+
+#endif /* SG_TABLE_H */
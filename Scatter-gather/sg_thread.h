@@ -0,0 +1,204 @@
+#ifndef SG_THREAD_H
+#define SG_THREAD_H
+
+#include "sg_port.h"
+
+/*
+ * Thin threading layer over Win32 and POSIX threads
+ *
+ * Note: only what the library needs, mutexes, condition variables,
+ * joinable threads, one-time initialization and thread-exit callbacks.
+ * All calls return 0 on success
+ */
+#if defined(_WIN32)
+#include <windows.h>
+
+typedef SRWLOCK sg_mutex_t;
+typedef CONDITION_VARIABLE sg_cond_t;
+typedef HANDLE sg_thread_t;
+typedef DWORD sg_thread_ret_t;
+#define SG_THREAD_CALL WINAPI
+
+static SG_INLINE int sg_mutex_init(sg_mutex_t *m)
+{
+	InitializeSRWLock(m);
+	return 0;
+}
+
+static SG_INLINE void sg_mutex_destroy(sg_mutex_t *m)
+{
+	(void)m;
+}
+
+static SG_INLINE void sg_mutex_lock(sg_mutex_t *m)
+{
+	AcquireSRWLockExclusive(m);
+}
+
+static SG_INLINE void sg_mutex_unlock(sg_mutex_t *m)
+{
+	ReleaseSRWLockExclusive(m);
+}
+
+static SG_INLINE int sg_cond_init(sg_cond_t *c)
+{
+	InitializeConditionVariable(c);
+	return 0;
+}
+
+static SG_INLINE void sg_cond_destroy(sg_cond_t *c)
+{
+	(void)c;
+}
+
+static SG_INLINE void sg_cond_wait(sg_cond_t *c, sg_mutex_t *m)
+{
+	SleepConditionVariableSRW(c, m, INFINITE, 0);
+}
+
+static SG_INLINE void sg_cond_signal(sg_cond_t *c)
+{
+	WakeConditionVariable(c);
+}
+
+static SG_INLINE void sg_cond_broadcast(sg_cond_t *c)
+{
+	WakeAllConditionVariable(c);
+}
+
+static SG_INLINE int sg_thread_create(sg_thread_t *t,
+                                    sg_thread_ret_t (SG_THREAD_CALL *fn)(void *),
+                                    void *arg)
+{
+	*t = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)fn, arg, 0, NULL);
+	return *t == NULL ? -1 : 0;
+}
+
+static SG_INLINE void sg_thread_join(sg_thread_t t)
+{
+	WaitForSingleObject(t, INFINITE);
+	CloseHandle(t);
+}
+
+typedef INIT_ONCE sg_once_t;
+#define SG_ONCE_INIT INIT_ONCE_STATIC_INIT
+
+static SG_INLINE BOOL CALLBACK sg_once_run(PINIT_ONCE once, PVOID fn, PVOID *ctx)
+{
+	(void)once;
+	(void)ctx;
+	((void (*)(void))fn)();
+	return TRUE;
+}
+
+static SG_INLINE void sg_once(sg_once_t *once, void (*fn)(void))
+{
+	InitOnceExecuteOnce(once, sg_once_run, (PVOID)fn, NULL);
+}
+
+typedef DWORD sg_thread_key_t;
+#define SG_THREAD_KEY_CALL NTAPI
+
+static SG_INLINE int sg_thread_key_create(sg_thread_key_t *key,
+                                          void (SG_THREAD_KEY_CALL *fn)(void *))
+{
+	*key = FlsAlloc(fn);
+	return *key == FLS_OUT_OF_INDEXES ? -1 : 0;
+}
+
+static SG_INLINE int sg_thread_key_set(sg_thread_key_t key, void *value)
+{
+	return FlsSetValue(key, value) ? 0 : -1;
+}
+
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t sg_mutex_t;
+typedef pthread_cond_t sg_cond_t;
+typedef pthread_t sg_thread_t;
+typedef void *sg_thread_ret_t;
+#define SG_THREAD_CALL
+
+static SG_INLINE int sg_mutex_init(sg_mutex_t *m)
+{
+	return pthread_mutex_init(m, NULL) == 0 ? 0 : -1;
+}
+
+static SG_INLINE void sg_mutex_destroy(sg_mutex_t *m)
+{
+	pthread_mutex_destroy(m);
+}
+
+static SG_INLINE void sg_mutex_lock(sg_mutex_t *m)
+{
+	pthread_mutex_lock(m);
+}
+
+static SG_INLINE void sg_mutex_unlock(sg_mutex_t *m)
+{
+	pthread_mutex_unlock(m);
+}
+
+static SG_INLINE int sg_cond_init(sg_cond_t *c)
+{
+	return pthread_cond_init(c, NULL) == 0 ? 0 : -1;
+}
+
+static SG_INLINE void sg_cond_destroy(sg_cond_t *c)
+{
+	pthread_cond_destroy(c);
+}
+
+static SG_INLINE void sg_cond_wait(sg_cond_t *c, sg_mutex_t *m)
+{
+	pthread_cond_wait(c, m);
+}
+
+static SG_INLINE void sg_cond_signal(sg_cond_t *c)
+{
+	pthread_cond_signal(c);
+}
+
+static SG_INLINE void sg_cond_broadcast(sg_cond_t *c)
+{
+	pthread_cond_broadcast(c);
+}
+
+static SG_INLINE int sg_thread_create(sg_thread_t *t,
+                                    sg_thread_ret_t (SG_THREAD_CALL *fn)(void *),
+                                    void *arg)
+{
+	return pthread_create(t, NULL, fn, arg) == 0 ? 0 : -1;
+}
+
+static SG_INLINE void sg_thread_join(sg_thread_t t)
+{
+	pthread_join(t, NULL);
+}
+
+typedef pthread_once_t sg_once_t;
+#define SG_ONCE_INIT PTHREAD_ONCE_INIT
+
+static SG_INLINE void sg_once(sg_once_t *once, void (*fn)(void))
+{
+	pthread_once(once, fn);
+}
+
+typedef pthread_key_t sg_thread_key_t;
+#define SG_THREAD_KEY_CALL
+
+static SG_INLINE int sg_thread_key_create(sg_thread_key_t *key,
+                                          void (SG_THREAD_KEY_CALL *fn)(void *))
+{
+	return pthread_key_create(key, fn) == 0 ? 0 : -1;
+}
+
+static SG_INLINE int sg_thread_key_set(sg_thread_key_t key, void *value)
+{
+	return pthread_setspecific(key, value) == 0 ? 0 : -1;
+}
+
+#endif
+
+#endif /* SG_THREAD_H */
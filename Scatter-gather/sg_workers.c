@@ -0,0 +1,251 @@
+#include <stdlib.h>
+#include "sg_workers.h"
+#include "sg_thread.h"
+
+/*
+* Tasks run by sg_workers_run
+*
+* Note: the last task to finish wakes up the waiting caller
+*/
+typedef struct sg_task_group_s {
+  sg_mutex_t lock;
+  sg_cond_t done;
+  int pending;
+} sg_task_group_t;
+
+struct sg_workers_s {
+  sg_mutex_t lock;
+  sg_cond_t wakeup;
+  sg_task_t* queue_head;
+  sg_task_t* queue_tail;
+  int stopping;
+  int num_threads;
+  sg_thread_t* threads;
+};
+
+/*
+* sg_task_finish Run a task and report it to its group, if any
+*
+* @in task      A task
+*/
+static void sg_task_finish(sg_task_t* task)
+{
+  sg_task_group_t* group = task->group;
+
+  task->run(task);
+
+  if (group == NULL) return;
+
+  sg_mutex_lock(&group->lock);
+  if (--group->pending == 0) sg_cond_signal(&group->done);
+  sg_mutex_unlock(&group->lock);
+}
+
+static sg_thread_ret_t SG_THREAD_CALL sg_worker_main(void* arg)
+{
+  sg_workers_t* workers = (sg_workers_t*)arg;
+  sg_task_t* task;
+
+  for (;;)
+  {
+    sg_mutex_lock(&workers->lock);
+    while (workers->queue_head == NULL && !workers->stopping)
+    {
+      sg_cond_wait(&workers->wakeup, &workers->lock);
+    }
+    // drain the queue before exiting
+    task = workers->queue_head;
+    if (task == NULL)
+    {
+      sg_mutex_unlock(&workers->lock);
+      break;
+    }
+    workers->queue_head = task->next;
+    if (workers->queue_head == NULL) workers->queue_tail = NULL;
+    sg_mutex_unlock(&workers->lock);
+
+    sg_task_finish(task);
+  }
+
+  return 0;
+}
+
+/*
+* sg_workers_create Start a pool of worker threads
+*
+* @in num_threads Number of worker threads, positive
+*
+* @ret          A worker pool, NULL on failure
+*/
+sg_workers_t* sg_workers_create(int num_threads)
+{
+  sg_workers_t* workers;
+  int i;
+
+  if (num_threads <= 0) return NULL;
+
+  workers = (sg_workers_t*)malloc(sizeof(sg_workers_t));
+  if (workers == NULL) return NULL;
+
+  workers->threads = (sg_thread_t*)malloc(num_threads * sizeof(sg_thread_t));
+  if (workers->threads == NULL)
+  {
+    free(workers);
+    return NULL;
+  }
+
+  sg_mutex_init(&workers->lock);
+  sg_cond_init(&workers->wakeup);
+  workers->queue_head = NULL;
+  workers->queue_tail = NULL;
+  workers->stopping = 0;
+  workers->num_threads = 0;
+
+  for (i = 0; i < num_threads; i++)
+  {
+    if (sg_thread_create(&workers->threads[i], sg_worker_main, workers) != 0) break;
+    workers->num_threads++;
+  }
+
+  // a pool without threads would never run anything
+  if (workers->num_threads == 0)
+  {
+    sg_workers_destroy(workers);
+    return NULL;
+  }
+
+  return workers;
+}
+
+/*
+* sg_workers_destroy Stop a pool of worker threads
+*
+* @in workers   A worker pool
+*
+* @note         Tasks already submitted are run before the threads exit.
+*/
+void sg_workers_destroy(sg_workers_t* workers)
+{
+  int i;
+
+  if (workers == NULL) return;
+
+  sg_mutex_lock(&workers->lock);
+  workers->stopping = 1;
+  sg_cond_broadcast(&workers->wakeup);
+  sg_mutex_unlock(&workers->lock);
+
+  for (i = 0; i < workers->num_threads; i++)
+  {
+    sg_thread_join(workers->threads[i]);
+  }
+
+  sg_cond_destroy(&workers->wakeup);
+  sg_mutex_destroy(&workers->lock);
+  free(workers->threads);
+  free(workers);
+}
+
+/*
+* sg_workers_count Number of threads in a worker pool
+*
+* @in workers   A worker pool
+*
+* @ret          Number of worker threads
+*/
+int sg_workers_count(const sg_workers_t* workers)
+{
+  if (workers == NULL) return 0;
+
+  return workers->num_threads;
+}
+
+/*
+* sg_workers_enqueue Append a task to the queue of a worker pool
+*
+* @in workers   A worker pool
+* @in task      Task to append, its group is already set
+*/
+static void sg_workers_enqueue(sg_workers_t* workers, sg_task_t* task)
+{
+  task->next = NULL;
+
+  sg_mutex_lock(&workers->lock);
+  if (workers->queue_tail == NULL)
+    workers->queue_head = task;
+  else
+    workers->queue_tail->next = task;
+  workers->queue_tail = task;
+  sg_cond_signal(&workers->wakeup);
+  sg_mutex_unlock(&workers->lock);
+}
+
+/*
+* sg_workers_submit Queue a task on a worker pool
+*
+* @in workers   A worker pool
+* @in task      Task to run on one of the worker threads
+*/
+void sg_workers_submit(sg_workers_t* workers, sg_task_t* task)
+{
+  if (workers == NULL || task == NULL) return;
+
+  task->group = NULL;
+  sg_workers_enqueue(workers, task);
+}
+
+/*
+* sg_workers_run Run tasks on a worker pool and wait for all of them
+*
+* @in workers   A worker pool
+* @in tasks     Array of tasks
+* @in task_size Size in bytes of each element of "tasks", the tasks are
+*               usually embedded in larger structures
+* @in num_tasks Number of tasks
+*
+* @note         The calling thread runs the first task itself.
+*/
+void sg_workers_run(sg_workers_t* workers, sg_task_t* tasks,
+                    int task_size, int num_tasks)
+{
+  sg_task_group_t group;
+  int i;
+
+  if (tasks == NULL || num_tasks <= 0) return;
+
+  // without a pool every task runs on the calling thread
+  if (workers == NULL)
+  {
+    for (i = 0; i < num_tasks; i++)
+    {
+      sg_task_t* task = (sg_task_t*)((char*)tasks + i * task_size);
+      task->group = NULL;
+      task->run(task);
+    }
+    return;
+  }
+
+  sg_mutex_init(&group.lock);
+  sg_cond_init(&group.done);
+  group.pending = num_tasks - 1;
+
+  for (i = 1; i < num_tasks; i++)
+  {
+    sg_task_t* task = (sg_task_t*)((char*)tasks + i * task_size);
+    task->group = &group;
+    sg_workers_enqueue(workers, task);
+  }
+
+  tasks->group = NULL;
+  tasks->run(tasks);
+
+  sg_mutex_lock(&group.lock);
+  while (group.pending > 0)
+  {
+    sg_cond_wait(&group.done, &group.lock);
+  }
+  sg_mutex_unlock(&group.lock);
+
+  sg_cond_destroy(&group.done);
+  sg_mutex_destroy(&group.lock);
+}
@@ -0,0 +1,69 @@
+#ifndef SG_WORKERS_H
+#define SG_WORKERS_H
+
+/*
+ * Worker pool task
+ *
+ * Note: callers embed the task as the first member of their own
+ * structure and cast back to it in "run". The pool never allocates
+ * or frees tasks, the task must stay valid until "run" returns
+ */
+typedef struct sg_task_s sg_task_t;
+struct sg_task_s {
+	void (*run)(sg_task_t *task);
+	struct sg_task_s *next;         /* used by the pool's queue */
+	struct sg_task_group_s *group;  /* used by sg_workers_run */
+};
+
+typedef struct sg_workers_s sg_workers_t;
+
+/*
+ * sg_workers_create Start a pool of worker threads
+ *
+ * @in num_threads Number of worker threads, positive
+ *
+ * @ret          A worker pool, NULL on failure
+ */
+extern sg_workers_t *sg_workers_create(int num_threads);
+
+/*
+ * sg_workers_destroy Stop a pool of worker threads
+ *
+ * @in workers   A worker pool
+ *
+ * @note         Tasks already submitted are run before the threads exit.
+ */
+extern void sg_workers_destroy(sg_workers_t *workers);
+
+/*
+ * sg_workers_count Number of threads in a worker pool
+ *
+ * @in workers   A worker pool
+ *
+ * @ret          Number of worker threads
+ */
+extern int sg_workers_count(const sg_workers_t *workers);
+
+/*
+ * sg_workers_submit Queue a task on a worker pool
+ *
+ * @in workers   A worker pool
+ * @in task      Task to run on one of the worker threads
+ */
+extern void sg_workers_submit(sg_workers_t *workers, sg_task_t *task);
+
+/*
+ * sg_workers_run Run tasks on a worker pool and wait for all of them
+ *
+ * @in workers   A worker pool
+ * @in tasks     Array of tasks
+ * @in task_size Size in bytes of each element of "tasks", the tasks are
+ *               usually embedded in larger structures
+ * @in num_tasks Number of tasks
+ *
+ * @note         The calling thread runs the first task itself.
+ */
+extern void sg_workers_run(sg_workers_t *workers, sg_task_t *tasks,
+                           int task_size, int num_tasks);
+
+#endif /* SG_WORKERS_H */